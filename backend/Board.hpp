@@ -1,14 +1,24 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
+#include <cstring>
 #include <cstdint>
 #include <iostream>
 #include <sstream>
-#include <random>
 #include <iomanip>
 #include <bitset>
+#include <cassert>
+#include <stdexcept>
+#include <algorithm>
 #include "MoveMap.hpp"
+#include "Zobrist.hpp"
+#include "MoveList.hpp"
 #include "constants.hpp"
+#include "Position.hpp"
+#include "History.hpp"
+#include "Fen.hpp"
+#include "Cuckoo.hpp"
 
 #ifdef _MSC_VER
     #include <intrin.h>
@@ -35,180 +45,205 @@
     }
 #endif
 
-class Board{
+// Check, pin and attack masks of the side to move, see Board::getAttackInfo
+struct AttackInfo {
+    uint64_t checkers;    // enemy pieces giving check
+    uint64_t checkMask;   // squares a non king move has to land on, every square when not in check, none in double check
+    uint64_t seenSquares; // squares attacked by the enemy, seen through our own king
+    uint64_t pinHV;       // rays from our king to an orthogonal pinner (pinner included)
+    uint64_t pinD12;      // rays from our king to a diagonal pinner (pinner included)
+    // for givesCheck, seen from the enemy king
+    uint64_t checkSquares[7]; // [piece] squares from which a piece of that type would attack the enemy king
+    uint64_t discoverers;     // our pieces that are the only blocker between one of our sliders and the enemy king
+};
+
+// How perft and the search take a move back. By default undoMove works the move backwards from its UndoRecord,
+// compile with -DUSE_COPY_MAKE to copy the position from before the move back instead (see Board::Snapshot).
+// Which one is faster depends on the machine, TestSuite runs both side by side.
+#ifdef USE_COPY_MAKE
+constexpr bool COPY_MAKE = true;
+#else
+constexpr bool COPY_MAKE = false;
+#endif
+
+// A Position plus the history of the game that led to it.
+// The Position part can be copied out on its own (Position snapshot = board;) without the history.
+class Board : public Position {
 
 public:
     // Variables //
-    // Bitboards
-    uint64_t whitePawns, blackPawns;
-    uint64_t whiteKnights, blackKnights;
-    uint64_t whiteBishops, blackBishops;
-    uint64_t whiteRooks, blackRooks;
-    uint64_t whiteQueens, blackQueens;
-    uint64_t whiteKing, blackKing;
-    uint64_t whitePieces;
-    uint64_t blackPieces;
-    uint64_t allOccupied;
-
-    // Game State Information
     uint16_t plycount; // The current "time"
-    bool whiteToMove;
-    int16_t fullmoveNumber;
-    uint64_t zobristKey;
 
     // Game History Information
-    uint16_t moveHistory[1000] = {0}; // Stores the moves in an arr
-    uint8_t capturedPieceHistory[1000] = {0}; // Stores the captured pieces in a vector. A piece can also be 0.
-    uint8_t enPassantFileHistory[1000] = {0}; // Stores the enPassant values in an arr
-    uint8_t castlingRightHistory[1000] = {0}; // Stores the castling rights in an arr
-    uint16_t halfmoveClockHistory[1000] = {0}; // Stores the halfMoveValues in an arr
-    uint64_t zobristKeyHistory[1000] = {0}; // Stores the zobristKey in an arr, for threefold repetition
-    std::unordered_map<uint64_t, int> positionHashHistory; // Stores the hashes with the # of times it occured
-    
-    // Zobrist hash values
-    uint64_t pieceHash[12][64]; // 12 types of pieces (6 white + 6 black) and 64 squares
-    uint64_t whiteToMoveHash;  // 1 element for current side
-    uint64_t castlingHash[16]; // 16 possible castling rights (4 bits)
-    uint64_t enPassantHash[8]; // 8 possible en passant files
+    GameHistory history;
+
+    // Attack info of the current position, computed on first use and dropped by every make/unmake.
+    // attackInfoValid holds which parts of it are up to date
+    static constexpr uint8_t CHECK_INFO = 1;       // checkers, checkMask
+    static constexpr uint8_t MOVEGEN_INFO = 2;     // seenSquares, pinHV, pinD12
+    static constexpr uint8_t GIVES_CHECK_INFO = 4; // checkSquares, discoverers
+    AttackInfo attackInfo;
+    uint8_t attackInfoValid = 0;
     
     // Constructors and Initialization
     Board(std::string fen = "") {
-        initializeZobristHashes(); // Initialize Zobrist hashe values when the board is created
         if (fen.empty()) {
             reset();
         } else {
             FENtoBoard(fen);
         }
     }
-    ~Board() {
-        // Clear hash map
-        positionHashHistory.clear();
-    }
     void reset(){
         // Reset all bitboards to 0
-        whitePawns = blackPawns = 0ULL;
-        whiteKnights = blackKnights = 0ULL;
-        whiteBishops = blackBishops = 0ULL;
-        whiteRooks = blackRooks = 0ULL;
-        whiteQueens = blackQueens = 0ULL;
-        whiteKing = blackKing = 0ULL;
+        std::memset(pieceBB, 0, sizeof(pieceBB));
 
         // Set up white pieces
-        whitePawns = 0x000000000000FF00ULL;
-        whiteKnights = 0x0000000000000042ULL;
-        whiteBishops = 0x0000000000000024ULL;
-        whiteRooks = 0x0000000000000081ULL;
-        whiteQueens = 0x0000000000000008ULL;
-        whiteKing = 0x0000000000000010ULL;
+        pieceBB[WHITE][PAWN] = 0x000000000000FF00ULL;
+        pieceBB[WHITE][KNIGHT] = 0x0000000000000042ULL;
+        pieceBB[WHITE][BISHOP] = 0x0000000000000024ULL;
+        pieceBB[WHITE][ROOK] = 0x0000000000000081ULL;
+        pieceBB[WHITE][QUEEN] = 0x0000000000000008ULL;
+        pieceBB[WHITE][KING] = 0x0000000000000010ULL;
 
         // Set up black pieces
-        blackPawns = 0x00FF000000000000ULL;
-        blackKnights = 0x4200000000000000ULL;
-        blackBishops = 0x2400000000000000ULL;
-        blackRooks = 0x8100000000000000ULL;
-        blackQueens = 0x0800000000000000ULL;
-        blackKing = 0x1000000000000000ULL;
+        pieceBB[BLACK][PAWN] = 0x00FF000000000000ULL;
+        pieceBB[BLACK][KNIGHT] = 0x4200000000000000ULL;
+        pieceBB[BLACK][BISHOP] = 0x2400000000000000ULL;
+        pieceBB[BLACK][ROOK] = 0x8100000000000000ULL;
+        pieceBB[BLACK][QUEEN] = 0x0800000000000000ULL;
+        pieceBB[BLACK][KING] = 0x1000000000000000ULL;
 
         // Set up color bitboards and all occupied squares
-        whitePieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        blackPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        allOccupied = whitePieces | blackPieces;
+        setOccupancy();
+        setMailbox();
 
         // reset game state information
         whiteToMove = true;
         fullmoveNumber = 1; // standard is 1
 
+        enPassantFile = 0xFF; // set all bits -> mean no en passant file
+        castlingRights = 0xF; // set all castling rights true
+        halfmoveClock = 0;
+        zobristKey = getZobristKey(); // get Key with current init
+
         // reset game history information
         plycount = 0;
-        std::memset(moveHistory, 0, sizeof(moveHistory));
-        std::memset(capturedPieceHistory, 0, sizeof(capturedPieceHistory));
-        std::memset(enPassantFileHistory, 0, sizeof(enPassantFileHistory));
-        std::memset(castlingRightHistory, 0, sizeof(castlingRightHistory));
-        std::memset(halfmoveClockHistory, 0, sizeof(halfmoveClockHistory));
-        std::memset(zobristKeyHistory, 0, sizeof(zobristKeyHistory));
-        zobristKey = getZobristKey(); // get Key with current init
-        zobristKeyHistory[plycount] = zobristKey;
-        enPassantFileHistory[0] = 0xFF; // set all bits -> mean no en passant file
-        castlingRightHistory[0] = 0xF; // set all castling rights true
-        // positionHashHistory.clear();
+        history.clear();
+        history.push(0, 0, castlingRights, enPassantFile, halfmoveClock, zobristKey);
+    }
+    // accepts a full FEN or the first four fields of an EPD line, the move counters default to 0 and 1
+    void FENtoBoard(std::string_view fen) {
+        FenFields fields;
+        splitFEN(fen, fields);
+        setFEN(fields);
     }
-    void FENtoBoard(std::string fen) {
+    void setFEN(const FenFields& fields) {
         // reset Board
-        emptyBoard();
-        // reset game history information
-        std::memset(moveHistory, 0, sizeof(moveHistory));
-        std::memset(capturedPieceHistory, 0, sizeof(capturedPieceHistory));
-        std::memset(enPassantFileHistory, 0xFF, sizeof(enPassantFileHistory));
-        std::memset(castlingRightHistory, 0, sizeof(castlingRightHistory));
-        std::memset(halfmoveClockHistory, 0, sizeof(halfmoveClockHistory));
-        std::memset(zobristKeyHistory, 0, sizeof(zobristKeyHistory));
-        
-        std::istringstream ss(fen);
-        std::string boardPos, activeColor, castling, enPassant, halfmoveClock, fullmoveN;
-        ss >> boardPos >> activeColor >> castling >> enPassant >> halfmoveClock >> fullmoveN;
+        std::memset(pieceBB, 0, sizeof(pieceBB));
+        std::memset(mailbox, 0, sizeof(mailbox));
 
         // Parse board position
         int rank = 7, file = 0;
-        for (char c : boardPos) {
+        for (char c : fields.placement) {
             if (c == '/') {
                 rank--;
                 file = 0;
-            } else if (std::isdigit(c)) {
+            } else if (c >= '1' && c <= '8') {
                 file += c - '0';
             } else {
-                uint64_t square = 1ULL << (rank * 8 + file);
-                switch (c) {
-                    case 'P': whitePawns |= square; break;
-                    case 'p': blackPawns |= square; break;
-                    case 'N': whiteKnights |= square; break;
-                    case 'n': blackKnights |= square; break;
-                    case 'B': whiteBishops |= square; break;
-                    case 'b': blackBishops |= square; break;
-                    case 'R': whiteRooks |= square; break;
-                    case 'r': blackRooks |= square; break;
-                    case 'Q': whiteQueens |= square; break;
-                    case 'q': blackQueens |= square; break;
-                    case 'K': whiteKing |= square; break;
-                    case 'k': blackKing |= square; break;
+                bool white;
+                uint8_t piece = fenPiece(c, white);
+                int square = rank * 8 + file;
+                if (piece && square >= 0 && square < 64) {
+                    pieceBB[white ? WHITE : BLACK][piece] |= 1ULL << square;
+                    mailbox[square] = piece;
                 }
                 file++;
             }
         }
 
         // Set color bitboards
-        whitePieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        blackPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        allOccupied = whitePieces | blackPieces;
+        setOccupancy();
 
         // Set game state information
-        whiteToMove = (activeColor == "w");
+        whiteToMove = fields.activeColor == "w";
         plycount = (whiteToMove) ? 0 : 1;
-        plycount += (std::stoi(fullmoveN)-1) * 2;
-
-        uint8_t castlingRights = 0;
-        if (castling.find('K') != std::string::npos) castlingRights |= 8;
-        if (castling.find('Q') != std::string::npos) castlingRights |= 4;
-        if (castling.find('k') != std::string::npos) castlingRights |= 2;
-        if (castling.find('q') != std::string::npos) castlingRights |= 1;
-        castlingRightHistory[plycount] = castlingRights;
-
-        uint8_t enPassantFile = 0xFF; // 255 is default
-        switch (enPassant[0]){
-            case 'a': enPassantFile = 0x0; break;
-            case 'b': enPassantFile = 0x1; break;
-            case 'c': enPassantFile = 0x2; break;
-            case 'd': enPassantFile = 0x3; break;
-            case 'e': enPassantFile = 0x4; break;
-            case 'f': enPassantFile = 0x5; break;
-            case 'g': enPassantFile = 0x6; break;
-            case 'h': enPassantFile = 0x7; break;
-        }
-        enPassantFileHistory[plycount] = enPassantFile;
-
-        halfmoveClockHistory[plycount] = std::stoi(halfmoveClock);
-        fullmoveNumber = std::stoi(fullmoveN);
+        plycount += (std::max(fields.fullmoveNumber, 1) - 1) * 2;
+
+        castlingRights = 0;
+        for (char c : fields.castling) {
+            switch (c) {
+                case 'K': castlingRights |= 8; break;
+                case 'Q': castlingRights |= 4; break;
+                case 'k': castlingRights |= 2; break;
+                case 'q': castlingRights |= 1; break;
+            }
+        }
+
+        enPassantFile = 0xFF; // 255 is default
+        if (!fields.enPassant.empty() && fields.enPassant[0] >= 'a' && fields.enPassant[0] <= 'h') {
+            enPassantFile = fields.enPassant[0] - 'a';
+        }
+
+        halfmoveClock = fields.halfmoveClock;
+        fullmoveNumber = fields.fullmoveNumber;
         zobristKey = getZobristKey();
-        zobristKeyHistory[plycount] = zobristKey;
+
+        // reset game history information
+        history.clear();
+        history.push(0, 0, castlingRights, enPassantFile, halfmoveClock, zobristKey);
+    }
+    // 32 byte binary form of the position, see PackedPosition. Throws for positions with more than 32 pieces.
+    PackedPosition encode() const {
+        if (popcount64(allOccupied) > 32) throw std::invalid_argument("a packed position holds at most 32 pieces");
+        PackedPosition packed;
+        packed.occupied = allOccupied;
+        std::memset(packed.pieces, 0, sizeof(packed.pieces));
+        uint64_t occupied = allOccupied;
+        for (int i = 0; occupied; ++i, occupied &= occupied - 1) {
+            uint8_t square = ctz64(occupied);
+            uint8_t code = mailbox[square] | (((pieceBB[BLACK][ALL] >> square) & 1) << 3);
+            packed.pieces[i >> 1] |= code << ((i & 1) * 4);
+        }
+        packed.state = uint8_t(whiteToMove ? 0 : 1) | (castlingRights << 1);
+        packed.enPassantFile = enPassantFile;
+        packed.halfmoveClock = halfmoveClock;
+        packed.fullmoveNumber = fullmoveNumber;
+        return packed;
+    }
+    // set up the position of a packed position, the game history starts over like after FENtoBoard
+    void decode(const PackedPosition& packed) {
+        std::memset(pieceBB, 0, sizeof(pieceBB));
+        std::memset(mailbox, 0, sizeof(mailbox));
+        // the zobrist key is summed up on the way instead of by getZobristKey
+        uint64_t key = 1;
+        uint64_t occupied = packed.occupied;
+        for (int i = 0; occupied && i < 32; ++i, occupied &= occupied - 1) {
+            uint8_t square = ctz64(occupied);
+            uint8_t code = (packed.pieces[i >> 1] >> ((i & 1) * 4)) & 0xF;
+            uint8_t piece = code & 7;
+            if (piece < PAWN || piece > KING) continue;
+            pieceBB[code >> 3][piece] |= 1ULL << square;
+            mailbox[square] = piece;
+            key ^= ZOBRIST.pieceHash[(piece - 1) * 2 + (code >> 3)][square];
+        }
+        setOccupancy();
+
+        whiteToMove = !(packed.state & 1);
+        castlingRights = (packed.state >> 1) & 0xF;
+        enPassantFile = packed.enPassantFile;
+        halfmoveClock = packed.halfmoveClock;
+        fullmoveNumber = packed.fullmoveNumber;
+        plycount = (whiteToMove) ? 0 : 1;
+        plycount += (std::max<int>(fullmoveNumber, 1) - 1) * 2;
+        if (enPassantFile > 7) enPassantFile = 0xFF;
+        key ^= ZOBRIST.castlingHash[castlingRights];
+        if (enPassantFile != 0xFF) key ^= ZOBRIST.enPassantHash[enPassantFile];
+        if (whiteToMove) key ^= ZOBRIST.whiteToMoveHash;
+        zobristKey = key;
+
+        history.clear();
+        history.push(0, 0, castlingRights, enPassantFile, halfmoveClock, zobristKey);
     }
     std::string BoardToFEN() {
         std::stringstream fen;
@@ -219,18 +254,18 @@ public:
             for (int file = 0; file < 8; file++) {
                 uint64_t square = 1ULL << (rank * 8 + file);
                 char piece = ' ';
-                if (whitePawns & square) piece = 'P';
-                else if (blackPawns & square) piece = 'p';
-                else if (whiteKnights & square) piece = 'N';
-                else if (blackKnights & square) piece = 'n';
-                else if (whiteBishops & square) piece = 'B';
-                else if (blackBishops & square) piece = 'b';
-                else if (whiteRooks & square) piece = 'R';
-                else if (blackRooks & square) piece = 'r';
-                else if (whiteQueens & square) piece = 'Q';
-                else if (blackQueens & square) piece = 'q';
-                else if (whiteKing & square) piece = 'K';
-                else if (blackKing & square) piece = 'k';
+                if (pieceBB[WHITE][PAWN] & square) piece = 'P';
+                else if (pieceBB[BLACK][PAWN] & square) piece = 'p';
+                else if (pieceBB[WHITE][KNIGHT] & square) piece = 'N';
+                else if (pieceBB[BLACK][KNIGHT] & square) piece = 'n';
+                else if (pieceBB[WHITE][BISHOP] & square) piece = 'B';
+                else if (pieceBB[BLACK][BISHOP] & square) piece = 'b';
+                else if (pieceBB[WHITE][ROOK] & square) piece = 'R';
+                else if (pieceBB[BLACK][ROOK] & square) piece = 'r';
+                else if (pieceBB[WHITE][QUEEN] & square) piece = 'Q';
+                else if (pieceBB[BLACK][QUEEN] & square) piece = 'q';
+                else if (pieceBB[WHITE][KING] & square) piece = 'K';
+                else if (pieceBB[BLACK][KING] & square) piece = 'k';
 
                 if (piece != ' ') {
                     if (emptySquares > 0) {
@@ -255,7 +290,6 @@ public:
 
         // Castling rights
         std::string castling = "";
-        uint8_t castlingRights = castlingRightHistory[plycount];
         if (castlingRights & 8) castling += 'K';
         if (castlingRights & 4) castling += 'Q';
         if (castlingRights & 2) castling += 'k';
@@ -264,7 +298,6 @@ public:
 
         // En passant target square
         std::string enPassantSquare;
-        uint8_t enPassantFile = enPassantFileHistory[plycount];
         switch (enPassantFile){
             case 0: (!whiteToMove ? enPassantSquare = "a3" : enPassantSquare = "a6"); break;
             case 1: (!whiteToMove ? enPassantSquare = "b3" : enPassantSquare = "b6"); break;
@@ -279,434 +312,367 @@ public:
         fen << (enPassantSquare.empty() ? "-" : enPassantSquare) << " ";
 
         // Halfmove clock and fullmove number
-        fen << halfmoveClockHistory[plycount] << " " << fullmoveNumber;
+        fen << halfmoveClock << " " << fullmoveNumber;
         return fen.str();
     }
     void emptyBoard(){
         // Reset all bitboards to 0, keep game state and game history information
-        whitePawns = blackPawns = 0ULL;
-        whiteKnights = blackKnights = 0ULL;
-        whiteBishops = blackBishops = 0ULL;
-        whiteRooks = blackRooks = 0ULL;
-        whiteQueens = blackQueens = 0ULL;
-        whiteKing = blackKing = 0ULL;
-        whitePieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        blackPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        allOccupied = whitePieces | blackPieces;
+        std::memset(pieceBB, 0, sizeof(pieceBB));
+        setOccupancy();
+        setMailbox();
     }
-    
-    // Zobrist Hashing functions
-    void initializeZobristHashes() {
-        std::random_device rd; // Obtain a random number from hardware
-        std::mt19937 generator(rd()); // Seed the generator
-        std::uniform_int_distribution<uint64_t> distribution(0, UINT64_MAX); // Uniform distribution for 64-bit integers
-
-        // Initialize piece hashes
-        for (int pieceType = 0; pieceType < 12; ++pieceType) {
-            for (int square = 0; square < 64; ++square) {
-                pieceHash[pieceType][square] = distribution(generator);
+    // rebuild the color bitboards and all occupied squares from the piece bitboards
+    void setOccupancy(){
+        for (int color = WHITE; color <= BLACK; ++color) {
+            pieceBB[color][ALL] = 0ULL;
+            for (int piece = PAWN; piece <= KING; ++piece) pieceBB[color][ALL] |= pieceBB[color][piece];
+        }
+        allOccupied = pieceBB[WHITE][ALL] | pieceBB[BLACK][ALL];
+        attackInfoValid = 0; // the pieces changed, the cached attack info is stale
+    }
+    // rebuild the mailbox from the bitboards
+    void setMailbox(){
+        for (int square = 0; square < 64; ++square) {
+            uint64_t squareBB = 1ULL << square;
+            mailbox[square] = 0;
+            for (int piece = PAWN; piece <= KING; ++piece) {
+                if (squareBB & (pieceBB[WHITE][piece] | pieceBB[BLACK][piece])) mailbox[square] = piece;
             }
         }
-
-        whiteToMoveHash = distribution(generator);
-
-        // Initialize castling rights
-        for (int i = 0; i < 16; ++i) {
-            castlingHash[i] = distribution(generator);
-        }
-
-        // Initialize en passant hashes
-        for (int i = 0; i < 8; ++i) {
-            enPassantHash[i] = distribution(generator);
-        }
     }
+    
+    // Zobrist Hashing functions
     inline uint64_t getZobristKey() {
         uint64_t hash = 1;
 
         // Hash in pieces on the board
-        uint64_t bitboard = whitePawns;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[0][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackPawns;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[1][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteKnights;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[2][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackKnights;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[3][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteBishops;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[4][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackBishops;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[5][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteRooks;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[6][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackRooks;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[7][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteQueens;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[8][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackQueens;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[9][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteKing;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[10][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackKing;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[11][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
+        for (int piece = PAWN; piece <= KING; ++piece) {
+            for (int color = WHITE; color <= BLACK; ++color) {
+                uint64_t bitboard = pieceBB[color][piece];
+                while (bitboard) {
+                    uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
+                    hash ^= ZOBRIST.pieceHash[(piece - 1) * 2 + color][square]; // XOR with the Zobrist key for this piece on this square
+                    bitboard &= bitboard - 1; // Clear the least significant bit set
+                }
+            }
         }
 
         // Add castling rights
-        uint8_t castlingRights = castlingRightHistory[plycount];
-        hash ^= castlingHash[castlingRights];
+        hash ^= ZOBRIST.castlingHash[castlingRights];
 
         // Add en passant file
-        uint8_t enPassantFile = enPassantFileHistory[plycount];
-        if (~enPassantFile) { // if not all bits are set
-            hash ^= enPassantHash[enPassantFile];
+        if (enPassantFile != 0xFF) { // if not all bits are set
+            hash ^= ZOBRIST.enPassantHash[enPassantFile];
         }
 
         // Incorporate the turn
-        (whiteToMove ? hash ^= whiteToMoveHash : hash);
+        (whiteToMove ? hash ^= ZOBRIST.whiteToMoveHash : hash);
 
         return hash;
     }
+    // Zobrist value of a piece (1-6) of a given color on a square, same indexing as getZobristKey
+    inline uint64_t pieceKey(uint8_t piece, bool white, uint8_t square) const {
+        return ZOBRIST.pieceHash[(piece - 1) * 2 + !white][square];
+    }
+
+    // Side relative bitboard access, resolved at compile time by the color template parameter
+    template<bool White> inline uint64_t& pawns() {return pieceBB[White ? WHITE : BLACK][PAWN];}
+    template<bool White> inline uint64_t& knights() {return pieceBB[White ? WHITE : BLACK][KNIGHT];}
+    template<bool White> inline uint64_t& bishops() {return pieceBB[White ? WHITE : BLACK][BISHOP];}
+    template<bool White> inline uint64_t& rooks() {return pieceBB[White ? WHITE : BLACK][ROOK];}
+    template<bool White> inline uint64_t& queens() {return pieceBB[White ? WHITE : BLACK][QUEEN];}
+    template<bool White> inline uint64_t& king() {return pieceBB[White ? WHITE : BLACK][KING];}
+    template<bool White> inline uint64_t& pieces() {return pieceBB[White ? WHITE : BLACK][ALL];}
+    // Squares attacked by a set of pawns of the given color
+    template<bool White> static inline uint64_t pawnAttacks(uint64_t pawnBB) {
+        return White ? ((pawnBB << 7) & ~FILE_H) | ((pawnBB << 9) & ~FILE_A)
+                     : ((pawnBB >> 9) & ~FILE_H) | ((pawnBB >> 7) & ~FILE_A);
+    }
 
     // Move Generation
+    // All generation functions are specialized on the side to move (White = true -> white to move),
+    // the runtime whiteToMove flag is only read once at the public entry points.
+    template<bool White>
     inline uint64_t pawnMoveableSquare(uint8_t from) {
         uint64_t pawn = 1ULL << from;
         uint64_t empty = ~allOccupied;
-        uint64_t enemies;
-        uint64_t singlePush, doublePush, leftCapture, rightCapture;
-        uint64_t startRank, notHFile, notAFile;
+        uint64_t enemies = pieces<!White>();
+        uint64_t singlePush, doublePush;
         
-        if (whiteToMove) {
-            enemies = blackPieces;
+        if (White) {
             singlePush = (pawn << 8) & empty;
             doublePush = ((pawn & RANK_2) << 16) & empty & (empty << 8);
-            leftCapture = (pawn << 7) & ~FILE_H & enemies;
-            rightCapture = (pawn << 9) & ~FILE_A & enemies;
         } else {
-            enemies = whitePieces;
             singlePush = (pawn >> 8) & empty;
             doublePush = ((pawn & RANK_7) >> 16) & empty & (empty >> 8);
-            leftCapture = (pawn >> 9) & ~FILE_H & enemies;
-            rightCapture = (pawn >> 7) & ~FILE_A & enemies;
         }
-        return singlePush | doublePush | leftCapture | rightCapture;
+        return singlePush | doublePush | (pawnAttacks<White>(pawn) & enemies);
+    }
+    // Destination squares of all pawn moves of White at once, one set per direction, so every target's pawn is
+    // to - PAWN_UP<White> (twice that for double pushes), to - PAWN_LEFT<White> or to - PAWN_RIGHT<White>.
+    // A pawn pinned along a file can only push along its pin, one pinned along a diagonal only capture along it.
+    // squares masks every set, e.g. the check mask.
+    struct PawnTargets {
+        uint64_t push;
+        uint64_t doublePush;
+        uint64_t captureLeft;  // toward the a file
+        uint64_t captureRight; // toward the h file
+    };
+    template<bool White> static constexpr int PAWN_UP = White ? 8 : -8;
+    template<bool White> static constexpr int PAWN_LEFT = White ? 7 : -9;
+    template<bool White> static constexpr int PAWN_RIGHT = White ? 9 : -7;
+    template<int Offset> static constexpr uint64_t shiftBB(uint64_t bb) {return Offset > 0 ? bb << Offset : bb >> -Offset;}
+
+    template<bool White>
+    inline PawnTargets pawnTargets(uint64_t pinHV, uint64_t pinD12, uint64_t squares) {
+        uint64_t empty = ~allOccupied;
+        uint64_t free = pawns<White>() & ~(pinHV | pinD12);
+        uint64_t filePinned = pawns<White>() & pinHV;
+        uint64_t diagonalPinned = pawns<White>() & pinD12;
+
+        uint64_t push = (shiftBB<PAWN_UP<White>>(free) | (shiftBB<PAWN_UP<White>>(filePinned) & pinHV)) & empty;
+        // a pinned pawn that can push once stays on its pin for the second step, it can't pass the pinner
+        uint64_t doublePush = shiftBB<PAWN_UP<White>>(push) & empty & (White ? RANK_4 : RANK_5);
+        uint64_t captureLeft = (shiftBB<PAWN_LEFT<White>>(free & ~FILE_A) | (shiftBB<PAWN_LEFT<White>>(diagonalPinned & ~FILE_A) & pinD12)) & pieces<!White>();
+        uint64_t captureRight = (shiftBB<PAWN_RIGHT<White>>(free & ~FILE_H) | (shiftBB<PAWN_RIGHT<White>>(diagonalPinned & ~FILE_H) & pinD12)) & pieces<!White>();
+        return {push & squares, doublePush & squares, captureLeft & squares, captureRight & squares};
+    }
+    // add a move for every square of targets, made by the pawn on to - offset,
+    // moves onto the last rank once per promotion piece
+    template<bool White, typename List>
+    inline void addPawnMoves(List& list, uint64_t targets, int offset, uint8_t type) {
+        constexpr uint64_t promotionRank = White ? RANK_8 : RANK_1;
+        for (uint64_t bb = targets & promotionRank; bb; bb &= bb - 1){
+            uint8_t to = ctz64(bb);
+            uint16_t move = ((to - offset) & 0x3F) | ((to & 0x3F) << 6) | (1 << 15);
+            for (int promotionPiece = 0; promotionPiece < 4; ++promotionPiece){ // knight, bishop, rook, queen
+                list.add(move | ((promotionPiece & 0x3) << 13), PAWN, mailbox[to], MOVE_PROMOTION);
+            }
+        }
+        for (uint64_t bb = targets & ~promotionRank; bb; bb &= bb - 1){
+            uint8_t to = ctz64(bb);
+            list.add(((to - offset) & 0x3F) | ((to & 0x3F) << 6), PAWN, mailbox[to], type);
+        }
+    }
+    template<bool White, typename List>
+    inline void addPawnMoves(List& list, const PawnTargets& targets) {
+        addPawnMoves<White>(list, targets.push, PAWN_UP<White>, MOVE_NORMAL);
+        addPawnMoves<White>(list, targets.doublePush, 2 * PAWN_UP<White>, MOVE_DOUBLE_PUSH);
+        addPawnMoves<White>(list, targets.captureLeft, PAWN_LEFT<White>, MOVE_NORMAL);
+        addPawnMoves<White>(list, targets.captureRight, PAWN_RIGHT<White>, MOVE_NORMAL);
+    }
+    // number of moves in targets, four for every move onto the last rank
+    template<bool White>
+    static inline int countPawnMoves(const PawnTargets& targets) {
+        constexpr uint64_t promotionRank = White ? RANK_8 : RANK_1;
+        return popcount64(targets.push) + popcount64(targets.doublePush) + popcount64(targets.captureLeft) + popcount64(targets.captureRight)
+             + 3 * (popcount64(targets.push & promotionRank) + popcount64(targets.captureLeft & promotionRank) + popcount64(targets.captureRight & promotionRank));
     }
+    // pawns of White that can capture en passant. A pinned pawn has to stay on its pin line and in check the capture
+    // has to take the checker or block. Taking both pawns off the rank at once can uncover a rook or queen on it,
+    // which the pin masks don't see, so the king's rays are looked up with both pawns gone (the diagonal one only
+    // matters for FENs where the captured pawn blocked a check that was already there).
+    template<bool White>
+    inline uint64_t enPassantCapturers(const AttackInfo& info) {
+        if (enPassantFile == 0xFF) return 0;
+        uint64_t toBB = 1ULL << (enPassantFile + (White ? 40 : 16));
+        uint64_t capturedBB = White ? toBB >> 8 : toBB << 8;
+        if (!(info.checkMask & (toBB | capturedBB))) return 0;
+        uint8_t kingSquare = ctz64(king<White>());
+        uint64_t capturers = 0;
+        for (uint64_t bb = pawnAttacks<!White>(toBB) & pawns<White>(); bb; bb &= bb - 1){
+            uint8_t from = ctz64(bb);
+            uint64_t fromBB = 1ULL << from;
+            if ((fromBB & (info.pinHV | info.pinD12)) && !(LINE[kingSquare][from] & toBB)) continue;
+            uint64_t occupied = (allOccupied ^ fromBB ^ capturedBB) | toBB;
+            if (rookAttacks(kingSquare, occupied) & (rooks<!White>() | queens<!White>())) continue;
+            if (bishopAttacks(kingSquare, occupied) & (bishops<!White>() | queens<!White>())) continue;
+            capturers |= fromBB;
+        }
+        return capturers;
+    }
+    template<bool White>
     inline uint64_t rookMoveableSquare(uint8_t from){
-        const MagicEntry& entry = ROOK_MAGICS[from];
-        uint64_t index = ((allOccupied & entry.mask) * entry.magic) >> (64 - entry.shift);
-        uint64_t attacks = entry.moves[index];
-        uint64_t enemyPieces = whiteToMove ? blackPieces : whitePieces;
-        return attacks & (enemyPieces | ~allOccupied);
+        uint64_t attacks = rookAttacks(from, allOccupied);
+        return attacks & ~pieces<White>();
     }
+    template<bool White>
     inline uint64_t knightMoveableSquare(uint8_t from) {
-        uint64_t knight_attacks = knight_lookup[from];
-        uint64_t blockers;
-        blockers = whiteToMove ? whitePieces : blackPieces;
-        return knight_attacks & ~blockers;
+        return knight_lookup[from] & ~pieces<White>();
     }
+    template<bool White>
     inline uint64_t bishopMoveableSquare(uint8_t from){
-        const MagicEntry& entry = BISHOP_MAGICS[from];
-        uint64_t index = ((allOccupied & entry.mask) * entry.magic) >> (64 - entry.shift);
-        uint64_t attacks = entry.moves[index];
-        uint64_t enemyPieces = whiteToMove ? blackPieces : whitePieces;
-        return attacks & (enemyPieces | ~allOccupied);
+        uint64_t attacks = bishopAttacks(from, allOccupied);
+        return attacks & ~pieces<White>();
     }
+    template<bool White>
     inline uint64_t queenMoveableSquare(uint8_t from){
-        uint64_t rookAttacks = rookMoveableSquare(from);
-        uint64_t bishopAttacks = bishopMoveableSquare(from);
-        return rookAttacks | bishopAttacks;
+        return rookMoveableSquare<White>(from) | bishopMoveableSquare<White>(from);
     }
+    template<bool White>
     inline uint64_t kingMoveableSquare(uint8_t from) {
-        uint64_t king_attacks = king_lookup[from];
-        uint64_t blockers = whiteToMove ? whitePieces : blackPieces;
-        uint64_t moveable_square = king_attacks & ~blockers;
-        return moveable_square;
+        return king_lookup[from] & ~pieces<White>();
     }
-    // calculate squares from enemy to own king (including enemy itself)
-    inline uint64_t generateCheckedSquares() {
-        uint64_t checkedSquares = 0xFFFFFFFFFFFFFFFFULL; // Start with all squares set
-        uint64_t kingBB = whiteToMove ? whiteKing : blackKing;
+    // enemy pieces that give check to the king of White
+    template<bool White>
+    inline uint64_t generateCheckers() {
+        uint64_t kingBB = king<White>();
         int kingSquare = ctz64(kingBB);
-        uint64_t opponentPieces = whiteToMove ? blackPieces : whitePieces;
-        uint64_t ownPieces = whiteToMove ? whitePieces : blackPieces;
-        uint64_t checkers = 0ULL;
-
-        // Check for attacks by pawns
-        uint64_t pawnAttacks = whiteToMove ? 
-            ((kingBB << 7) & ~FILE_H) | ((kingBB << 9) & ~FILE_A) :
-            ((kingBB >> 7) & ~FILE_A) | ((kingBB >> 9) & ~FILE_H);
-        uint64_t opponentPawns = whiteToMove ? blackPawns : whitePawns;
-        checkers |= pawnAttacks & opponentPawns;
-
-        // Check for attacks by knights
-        uint64_t knightAttacks = knightMoveableSquare(kingSquare);
-        uint64_t opponentKnights = whiteToMove ? blackKnights : whiteKnights;
-        checkers |= knightAttacks & opponentKnights;
-
-        // Check for attacks by bishops and queens
-        uint64_t bishopAttacks = bishopMoveableSquare(kingSquare);
-        uint64_t opponentBishopsQueens = whiteToMove ? (blackBishops | blackQueens) : (whiteBishops | whiteQueens);
-        uint64_t bishopCheckers = bishopAttacks & opponentBishopsQueens;
-        checkers |= bishopCheckers;
-
-        // Check for attacks by rooks and queens
-        uint64_t rookAttacks = rookMoveableSquare(kingSquare);
-        uint64_t opponentRooksQueens = whiteToMove ? (blackRooks | blackQueens) : (whiteRooks | whiteQueens);
-        uint64_t rookCheckers = rookAttacks & opponentRooksQueens;
-        checkers |= rookCheckers;
-
+        return (pawnAttacks<White>(kingBB) & pawns<!White>())
+             | (knight_lookup[kingSquare] & knights<!White>())
+             | (bishopAttacks(kingSquare, allOccupied) & (bishops<!White>() | queens<!White>()))
+             | (rookAttacks(kingSquare, allOccupied) & (rooks<!White>() | queens<!White>()));
+    }
+    // calculate squares from enemy to own king (including enemy itself)
+    template<bool White>
+    inline uint64_t generateCheckedSquares(uint64_t checkers) {
         // Count the number of checkers
         int numCheckers = popcount64(checkers);
 
         if (numCheckers == 0) {
-            return checkedSquares; // No check, all squares are valid
+            return 0xFFFFFFFFFFFFFFFFULL; // No check, all squares are valid
         } else if (numCheckers > 1) {
             return 0ULL; // Double check, no moves are valid (except for king moves)
         } else {
-            // Single check
-            uint64_t checkerSquare = 1ULL << ctz64(checkers);
-            if (bishopCheckers) {
-                return (bishopMoveableSquare(kingSquare) & bishopMoveableSquare(ctz64(checkerSquare))) | checkerSquare;
-            } else if (rookCheckers) {
-                return (rookMoveableSquare(kingSquare) & rookMoveableSquare(ctz64(checkerSquare))) | checkerSquare;
-            } else {
-                return checkerSquare; // For pawn or knight checks, only capturing the checker is valid
-            }
+            // Single check, block the ray of a slider or capture the checker
+            return BETWEEN[ctz64(king<White>())][ctz64(checkers)];
         }
     }
     // calculate seen squares by enemy pieces
+    template<bool White>
     inline uint64_t generateSeenSquares() {
-        uint64_t seenSquares = 0ULL;
-
-        uint64_t kingmask;
-        uint64_t opponentPieces, opponentPawns, opponentKnights, opponentBishops, opponentRooks, opponentQueens, opponentKing;
-        if (whiteToMove) {
-            opponentPieces = blackPieces;
-            opponentPawns = blackPawns;
-            opponentKnights = blackKnights;
-            opponentBishops = blackBishops;
-            opponentRooks = blackRooks;
-            opponentQueens = blackQueens;
-            opponentKing = blackKing;
-
-            kingmask = 1ULL << ctz64(whiteKing);
-            whiteKing ^= kingmask;
-            whitePieces ^= kingmask;
-            allOccupied ^= kingmask;
-        } else {
-            opponentPieces = whitePieces;
-            opponentPawns = whitePawns;
-            opponentKnights = whiteKnights;
-            opponentBishops = whiteBishops;
-            opponentRooks = whiteRooks;
-            opponentQueens = whiteQueens;
-            opponentKing = whiteKing;
-
-            kingmask = 1ULL << ctz64(blackKing);
-            blackKing ^= kingmask;
-            blackPieces ^= kingmask;
-            allOccupied ^= kingmask;
-        }
-
-        while (opponentPieces) {
-            uint8_t from = ctz64(opponentPieces);
-            uint64_t piece = 1ULL << from;
-            seenSquares |= 
-                ((piece & opponentPawns) ? (whiteToMove ? 
-                    ((piece >> 7) & ~FILE_A) | ((piece >> 9) & ~FILE_H) :
-                    ((piece << 7) & ~FILE_H) | ((piece << 9) & ~FILE_A)) : 0ULL) |
-                ((piece & opponentKnights) ? knightMoveableSquare(from) : 0ULL) |
-                ((piece & opponentBishops) ? bishopMoveableSquare(from) : 0ULL) |
-                ((piece & opponentRooks) ? rookMoveableSquare(from) : 0ULL) |
-                ((piece & opponentQueens) ? queenMoveableSquare(from) : 0ULL) |
-                ((piece & opponentKing) ? kingMoveableSquare(from) : 0ULL);
-            
-            opponentPieces &= opponentPieces - 1;  // Clear the least significant bit
-        }
-
-        if (whiteToMove){
-            whiteKing ^= kingmask;
-            whitePieces ^= kingmask;
-            allOccupied ^= kingmask;
-        } else{
-            blackKing ^= kingmask;
-            blackPieces ^= kingmask;
-            allOccupied ^= kingmask;
+        // remove our king from the occupancy, so it cant step back along the ray of a checking slider
+        uint64_t occupied = allOccupied ^ king<White>();
+        uint64_t seenSquares = pawnAttacks<!White>(pawns<!White>()) | king_lookup[ctz64(king<!White>())];
+
+        uint64_t opponentKnights = knights<!White>();
+        while (opponentKnights) {
+            seenSquares |= knight_lookup[ctz64(opponentKnights)];
+            opponentKnights &= opponentKnights - 1;  // Clear the least significant bit
+        }
+        uint64_t opponentDiagonals = bishops<!White>() | queens<!White>();
+        while (opponentDiagonals) {
+            seenSquares |= bishopAttacks(ctz64(opponentDiagonals), occupied);
+            opponentDiagonals &= opponentDiagonals - 1;
+        }
+        uint64_t opponentOrthogonals = rooks<!White>() | queens<!White>();
+        while (opponentOrthogonals) {
+            seenSquares |= rookAttacks(ctz64(opponentOrthogonals), occupied);
+            opponentOrthogonals &= opponentOrthogonals - 1;
         }
         return seenSquares;
     }
     // generate pin masks
+    template<bool White>
     inline uint64_t generatePinD12(){
         uint64_t pinD12 = 0;
-        if (whiteToMove){
-            uint8_t kingSquare = ctz64(whiteKing);
-            const MagicEntry& entry = BISHOP_MAGICS[kingSquare];
-            uint64_t index = ((blackPieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (blackQueens | blackBishops);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenD12(pinnerSquare, kingSquare);
-                if (popcount64(betweenSquares & whitePieces) == 2){
-                    pinD12 |= betweenSquares;
-                }
-                pinners &= pinners - 1;
-            }
-        } else{
-            uint8_t kingSquare = ctz64(blackKing);
-            const MagicEntry& entry = BISHOP_MAGICS[kingSquare];
-            uint64_t index = ((whitePieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (whiteQueens | whiteBishops);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenD12(pinnerSquare, kingSquare);
-                if (popcount64(betweenSquares & blackPieces) == 2){
-                    pinD12 |= betweenSquares;
-                }
-                pinners &= pinners - 1;
+        uint8_t kingSquare = ctz64(king<White>());
+        uint64_t pinners = bishopAttacks(kingSquare, pieces<!White>()) & (queens<!White>() | bishops<!White>());
+        while (pinners) {
+            uint64_t ray = BETWEEN[kingSquare][ctz64(pinners)]; // pinner included
+            if (popcount64(ray & pieces<White>()) == 1){
+                pinD12 |= ray;
             }
+            pinners &= pinners - 1;
         }
         return pinD12;
     };
-    inline uint64_t betweenD12(uint8_t piecesquare, uint8_t kingsquare){
-        uint64_t mask = 0;
-    
-        // Calculate row and column difference
-        int row1 = piecesquare / 8;
-        int col1 = piecesquare % 8;
-        int row2 = kingsquare / 8;
-        int col2 = kingsquare % 8;
-        
-        int step;
-        
-        if (col2 > col1){
-            if (row2 > row1){
-                step = 9; // Moving up-right
-            }else{
-                step = -7; // Moving down-right
-            }
-        } else{
-            if (row2 > row1){
-                step = 7; // Moving up-left
-            }else{
-                step = -9; // Moving down-left
-            }
-        }
-
-        // Calculate the range of squares between square1 and square2
-        int steps = (kingsquare - piecesquare) / step; // add one extra step to include the square behind the king
-        
-        int sq = piecesquare; // start stepping at piecesquare
-        while ((steps >= 0) && (sq >= 0) && (sq <=63)) {
-            mask |= 1ULL << sq;
-            sq += step;
-            steps--;
-        }
-        return mask;
-    };
+    template<bool White>
     inline uint64_t generatePinHV(){
         uint64_t pinHV = 0;
-        if (whiteToMove){
-            uint8_t kingSquare = ctz64(whiteKing);
-            const MagicEntry& entry = ROOK_MAGICS[kingSquare];
-            uint64_t index = ((blackPieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (blackQueens | blackRooks);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenHV(kingSquare, pinnerSquare);
-                if (popcount64(betweenSquares & whitePieces) == 2){
-                    pinHV |= betweenSquares;
-                }
-                pinners &= pinners - 1;
-            }
-        } else{
-            uint8_t kingSquare = ctz64(blackKing);
-            const MagicEntry& entry = ROOK_MAGICS[kingSquare];
-            uint64_t index = ((whitePieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (whiteQueens | whiteRooks);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenHV(kingSquare, pinnerSquare);
-                if (popcount64(betweenSquares & blackPieces) == 2){
-                    pinHV |= betweenSquares;
-                }
-                pinners &= pinners - 1;
+        uint8_t kingSquare = ctz64(king<White>());
+        uint64_t pinners = rookAttacks(kingSquare, pieces<!White>()) & (queens<!White>() | rooks<!White>());
+        while (pinners) {
+            uint64_t ray = BETWEEN[kingSquare][ctz64(pinners)]; // pinner included
+            if (popcount64(ray & pieces<White>()) == 1){
+                pinHV |= ray;
             }
+            pinners &= pinners - 1;
         }
         return pinHV;
     };
-    inline uint64_t betweenHV(uint8_t square1, uint8_t square2){
-        uint64_t mask = 0;
-        if (square1 % 8 == square2 % 8) { // If on the same file (vertically aligned)
-            int minSquare = std::min(square1, square2);
-            int maxSquare = std::max(square1, square2);
-            for (int i = minSquare; i <= maxSquare; i += 8) {
-                mask |= (1ULL << i);
-            }
-        }
-        else if (square1 / 8 == square2 / 8) { // If on the same rank (horizontally aligned)
-            int minSquare = std::min(square1, square2);
-            int maxSquare = std::max(square1, square2);
-            for (int i = minSquare; i <= maxSquare; ++i) {
-                mask |= (1ULL << i);
+    // Cached attack info of White, which has to be the side to move.
+    // getCheckInfo only fills in checkers and checkMask, which is all isCheck needs,
+    // getAttackInfo adds the seen squares and pins for move generation,
+    // getGivesCheckInfo fills in the check squares and discovered check candidates for givesCheck.
+    template<bool White>
+    inline const AttackInfo& getCheckInfo() {
+        if (!(attackInfoValid & CHECK_INFO)) {
+            attackInfo.checkers = generateCheckers<White>();
+            attackInfo.checkMask = generateCheckedSquares<White>(attackInfo.checkers);
+            attackInfoValid |= CHECK_INFO;
+        }
+        return attackInfo;
+    }
+    template<bool White>
+    inline const AttackInfo& getAttackInfo() {
+        if (!(attackInfoValid & MOVEGEN_INFO)) {
+            getCheckInfo<White>();
+            attackInfo.seenSquares = generateSeenSquares<White>();
+            attackInfo.pinHV = generatePinHV<White>();
+            attackInfo.pinD12 = generatePinD12<White>();
+            attackInfoValid |= MOVEGEN_INFO;
+        }
+#ifdef WOKFISCH_DEBUG
+        assert(attackInfo.checkers == generateCheckers<White>() && attackInfo.seenSquares == generateSeenSquares<White>()
+               && attackInfo.pinHV == generatePinHV<White>() && attackInfo.pinD12 == generatePinD12<White>() && "cached attack info is stale");
+#endif
+        return attackInfo;
+    }
+    inline const AttackInfo& getAttackInfo() {
+        return whiteToMove ? getAttackInfo<true>() : getAttackInfo<false>();
+    }
+    template<bool White>
+    inline const AttackInfo& getGivesCheckInfo() {
+        if (!(attackInfoValid & GIVES_CHECK_INFO)) {
+            uint64_t enemyKing = king<!White>();
+            uint8_t kingSquare = ctz64(enemyKing);
+            uint64_t diagonals = bishopAttacks(kingSquare, allOccupied);
+            uint64_t orthogonals = rookAttacks(kingSquare, allOccupied);
+            attackInfo.checkSquares[ALL] = 0;
+            attackInfo.checkSquares[PAWN] = pawnAttacks<!White>(enemyKing);
+            attackInfo.checkSquares[KNIGHT] = knight_lookup[kingSquare];
+            attackInfo.checkSquares[BISHOP] = diagonals;
+            attackInfo.checkSquares[ROOK] = orthogonals;
+            attackInfo.checkSquares[QUEEN] = diagonals | orthogonals;
+            attackInfo.checkSquares[KING] = 0;
+
+            // our sliders that would see the king through our own pieces, enemy pieces stop the rays
+            attackInfo.discoverers = 0;
+            uint64_t snipers = (bishopAttacks(kingSquare, pieces<!White>()) & (bishops<White>() | queens<White>()))
+                             | (rookAttacks(kingSquare, pieces<!White>()) & (rooks<White>() | queens<White>()));
+            while (snipers) {
+                // squares strictly between the sniper and the king, the ray between them only holds our pieces
+                uint64_t sniper = snipers & -snipers;
+                uint64_t blockers = (BETWEEN[kingSquare][ctz64(sniper)] ^ sniper) & allOccupied;
+                if (popcount64(blockers) == 1) attackInfo.discoverers |= blockers;
+                snipers &= snipers - 1;
             }
+            attackInfoValid |= GIVES_CHECK_INFO;
         }
-        return mask;
-    };
-    // generate all legal moves in a position
-    inline std::vector<uint16_t> generateAllLegalMoves() {
-        std::vector<uint16_t> allLegalMoves;
-        allLegalMoves.reserve(218);
-        uint64_t seenSquares = generateSeenSquares();
-        uint64_t checkedSquares = generateCheckedSquares();
-        uint64_t currentSidePieces = whiteToMove ? whitePieces : blackPieces;
+        return attackInfo;
+    }
+    // for code that changes the position without makeMove/unmakeMove
+    inline void invalidateAttackInfo() {attackInfoValid = 0;}
+
+    // generate all legal moves for the side White
+    // List is a MoveList of 16 bit moves or a MoveRecordList that also carries the moved and captured piece and the move type.
+    // Gen picks the moves of one stage of the search: GEN_CAPTURES are captures, en passant and every promotion,
+    // GEN_QUIETS the rest including castling, GEN_ALL both.
+    template<bool White, typename List = MoveList, int Gen = GEN_ALL>
+    inline List generateMoves() {
+        const AttackInfo& info = getAttackInfo<White>();
+        if (info.checkers) return generateEvasions<White, List, Gen>(info);
+        List allLegalMoves;
+        uint64_t seenSquares = info.seenSquares;
+        constexpr uint64_t promotionRank = White ? RANK_8 : RANK_1;
+        uint64_t targets = Gen == GEN_ALL ? ~0ULL : Gen == GEN_CAPTURES ? pieces<!White>() : ~allOccupied;
+        uint64_t pawnStage = Gen == GEN_ALL ? ~0ULL : Gen == GEN_CAPTURES ? pieces<!White>() | promotionRank : ~allOccupied & ~promotionRank;
+        uint64_t checkedSquares = info.checkMask & targets;
+        uint64_t pawnSquares = info.checkMask & pawnStage;
         
-        uint64_t pinHV = generatePinHV();
-        uint64_t pinD12 = generatePinD12();
+        uint64_t pinHV = info.pinHV;
+        uint64_t pinD12 = info.pinD12;
         uint64_t allPins = pinHV | pinD12;
 
         uint64_t rook_nopin;
@@ -716,195 +682,69 @@ public:
         uint64_t queen_nopin;
         uint64_t queen_pinHV;
         uint64_t queen_pinD12;
-        uint64_t pawns_nopin;
-        uint64_t pawns_pinHV;
-        uint64_t pawns_pinD12;
         uint64_t knight;
-        uint64_t king;
-
-        if (whiteToMove){
-            rook_nopin = whiteRooks & ~allPins;
-            rook_pin = whiteRooks & pinHV;
-            bishop_nopin = whiteBishops & ~allPins;
-            bishop_pin = whiteBishops & pinD12;
+        uint64_t king_bb;
 
-            queen_nopin = whiteQueens & ~allPins; 
-            queen_pinHV = whiteQueens & pinHV;
-            queen_pinD12 = whiteQueens & pinD12;
+        rook_nopin = rooks<White>() & ~allPins;
+        rook_pin = rooks<White>() & pinHV;
+        bishop_nopin = bishops<White>() & ~allPins;
+        bishop_pin = bishops<White>() & pinD12;
 
-            pawns_nopin = whitePawns & ~allPins;
-            pawns_pinHV = whitePawns & pinHV;
-            pawns_pinD12 = whitePawns & pinD12;
+        queen_nopin = queens<White>() & ~allPins; 
+        queen_pinHV = queens<White>() & pinHV;
+        queen_pinD12 = queens<White>() & pinD12;
 
-            knight = whiteKnights & ~allPins; // a pinned knight can never move
-            king = whiteKing;
-        } else{
-            rook_nopin = blackRooks & ~allPins;
-            rook_pin = blackRooks & pinHV;
-            bishop_nopin = blackBishops & ~allPins;
-            bishop_pin = blackBishops & pinD12;
 
-            queen_nopin = blackQueens & ~allPins; 
-            queen_pinHV = blackQueens & pinHV;
-            queen_pinD12 = blackQueens & pinD12;
+        knight = knights<White>() & ~allPins; // a pinned knight can never move
+        king_bb = king<White>();
 
-            pawns_nopin = blackPawns & ~allPins;
-            pawns_pinHV = blackPawns & pinHV;
-            pawns_pinD12 = blackPawns & pinD12;
-
-            knight = blackKnights & ~allPins; // a pinned knight can never move
-            king = blackKing;
-        }
-
-        // check for enPassantMove. Add if possible
-        uint8_t enPassantFile = enPassantFileHistory[plycount];
-        if (enPassantFile != 0xFF){
-            if (whiteToMove){
-                uint8_t enPassantSquare = enPassantFile + 40;
-                // Check if capture from left is possible, cant be file 0
-                if ((whitePawns & (1ULL << (enPassantFile + 31))) && enPassantFile != 0){
-                    uint16_t move = ((enPassantFile + 31) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-                 // Check if capture from right is possible, cant be file 7
-                if ((whitePawns & (1ULL << (enPassantFile + 33))) && enPassantFile != 7){
-                    uint16_t move = ((enPassantFile + 33) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-            } else{
-                uint8_t enPassantSquare = enPassantFile + 16;
-                // Check if capture from left is possible, cant be file 0
-                if ((blackPawns & (1ULL << (enPassantFile + 23))) && enPassantFile != 0){
-                    uint16_t move = ((enPassantFile + 23) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-                // Check if capture from right is possible, cant be file 7
-                if ((blackPawns & (1ULL << (enPassantFile + 25))) && enPassantFile != 7){
-                    uint16_t move = ((enPassantFile + 25) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
+        // en passant captures
+        if (Gen != GEN_QUIETS){
+            uint8_t enPassantSquare = White ? enPassantFile + 40 : enPassantFile + 16;
+            for (uint64_t capturers = enPassantCapturers<White>(info); capturers; capturers &= capturers - 1){
+                allLegalMoves.add((ctz64(capturers) & 0x3F) | ((enPassantSquare & 0x3F) << 6), PAWN, PAWN, MOVE_EN_PASSANT);
             }
         }
 
-        // Add castling if possible
-        if (!isCheck()){
-            uint8_t castlingRights = castlingRightHistory[plycount];
-            if (whiteToMove){
+        // Add castling if possible, the checked squares mask is full only when not in check
+        if (Gen != GEN_CAPTURES && info.checkMask == 0xFFFFFFFFFFFFFFFFULL){
+            if (White){
                 // castling right has to be set, rook has to be at square 7, squares 5 and 6 cant be seen or occupied 
-                if (((castlingRights & 8) >> 3) && (whiteRooks & (1ULL << 7)) && !(seenSquares & WKS_SEEN) && !(allOccupied & WKS_OCC)){
+                if (((castlingRights & 8) >> 3) && (pieceBB[WHITE][ROOK] & (1ULL << 7)) && !(seenSquares & WKS_SEEN) && !(allOccupied & WKS_OCC)){
                     uint16_t move = (4 & 0x3F) | ((6 & 0x3F) << 6) | (1 << 12);
-                    allLegalMoves.emplace_back(move);
+                    allLegalMoves.add(move, KING, 0, MOVE_CASTLING);
                 }
                 // castling right has to be set, rook has to be at square 0, squares 3 and 2 cant be seen and square 1 cant be occupied
-                if (((castlingRights & 4) >> 2) && (whiteRooks & (1ULL << 0)) && !(seenSquares & WQS_SEEN) && !(allOccupied & WQS_OCC)){
+                if (((castlingRights & 4) >> 2) && (pieceBB[WHITE][ROOK] & (1ULL << 0)) && !(seenSquares & WQS_SEEN) && !(allOccupied & WQS_OCC)){
                     uint16_t move = (4 & 0x3F) | ((2 & 0x3F) << 6) | (1 << 12);
-                    allLegalMoves.emplace_back(move);
+                    allLegalMoves.add(move, KING, 0, MOVE_CASTLING);
                 }
             }
             else{
                 // castling right has to be set, rook has to be at square 63, squares 61 and 62 cant be seen or occupied
-                if (((castlingRights & 2) >> 1) && (blackRooks & (1ULL << 63)) && !(seenSquares & BKS_SEEN) && !(allOccupied & BKS_OCC)){
+                if (((castlingRights & 2) >> 1) && (pieceBB[BLACK][ROOK] & (1ULL << 63)) && !(seenSquares & BKS_SEEN) && !(allOccupied & BKS_OCC)){
                     uint16_t move = (60 & 0x3F) | ((62 & 0x3F) << 6) | (1 << 12);
-                    allLegalMoves.emplace_back(move);
+                    allLegalMoves.add(move, KING, 0, MOVE_CASTLING);
                 }
                 // castling right has to be set, rook has to be at square 56, squares 59 and 58 cant be seen and square 57 cant be occupied
-                if ((castlingRights & 1) && (blackRooks & (1ULL << 56)) && !(seenSquares & BQS_SEEN) && !(allOccupied & BQS_OCC)){
+                if ((castlingRights & 1) && (pieceBB[BLACK][ROOK] & (1ULL << 56)) && !(seenSquares & BQS_SEEN) && !(allOccupied & BQS_OCC)){
                     uint16_t move = (60 & 0x3F) | ((58 & 0x3F) << 6) | (1 << 12);
-                    allLegalMoves.emplace_back(move);
+                    allLegalMoves.add(move, KING, 0, MOVE_CASTLING);
                 }
             }
         }
 
-        // Pawns not pinned
-        while (pawns_nopin){
-            uint8_t from = ctz64(pawns_nopin);
-            uint64_t moveableSquares = pawnMoveableSquare(from);
-            uint64_t legal_squares = moveableSquares & checkedSquares;
-            while (legal_squares){
-                uint8_t to = ctz64(legal_squares);
-                if (whiteToMove ? (to > 55) : (to < 8)){
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((0 & 0x3) << 13) | (1 << 15)); // knight
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((1 & 0x3) << 13) | (1 << 15)); // bishop
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((2 & 0x3) << 13) | (1 << 15)); // rook
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((3 & 0x3) << 13) | (1 << 15)); // queen
-                } else{
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
-                }
-                legal_squares &= legal_squares - 1;
-            }
-            pawns_nopin &= pawns_nopin - 1;
-        }
-        // Pawns HV pinned
-        while (pawns_pinHV){
-            uint8_t from = ctz64(pawns_pinHV);
-            uint64_t moveableSquares = pawnMoveableSquare(from);
-            uint64_t legal_squares = moveableSquares & checkedSquares & pinHV;
-            while (legal_squares){
-                uint8_t to = ctz64(legal_squares);
-                if (whiteToMove ? (to > 55) : (to < 8)){
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((0 & 0x3) << 13) | (1 << 15)); // knight
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((1 & 0x3) << 13) | (1 << 15)); // bishop
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((2 & 0x3) << 13) | (1 << 15)); // rook
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((3 & 0x3) << 13) | (1 << 15)); // queen
-                } else{
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
-                }
-                legal_squares &= legal_squares - 1;
-            }
-            pawns_pinHV &= pawns_pinHV - 1;
-        }
-        // Pawns D12 pinned
-        while (pawns_pinD12){
-            uint8_t from = ctz64(pawns_pinD12);
-            uint64_t moveableSquares = pawnMoveableSquare(from);
-            uint64_t legal_squares = moveableSquares & checkedSquares & pinD12;
-            while (legal_squares){
-                uint8_t to = ctz64(legal_squares);
-                if (whiteToMove ? (to > 55) : (to < 8)){
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((0 & 0x3) << 13) | (1 << 15)); // knight
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((1 & 0x3) << 13) | (1 << 15)); // bishop
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((2 & 0x3) << 13) | (1 << 15)); // rook
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6) | ((3 & 0x3) << 13) | (1 << 15)); // queen
-                } else{
-                    allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
-                }
-                legal_squares &= legal_squares - 1;
-            }
-            pawns_pinD12 &= pawns_pinD12 - 1;
-        }
+        // Pawns, set-wise: one shift of all pawns per direction, the moves are read off the destination sets
+        addPawnMoves<White>(allLegalMoves, pawnTargets<White>(pinHV, pinD12, pawnSquares));
 
         // Rooks not pinned
         while (rook_nopin){
             uint8_t from = ctz64(rook_nopin);
-            uint64_t moveableSquares = rookMoveableSquare(from);
+            uint64_t moveableSquares = rookMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), ROOK, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             rook_nopin &= rook_nopin - 1;
@@ -912,11 +752,11 @@ public:
         // Rooks pinned
         while (rook_pin){
             uint8_t from = ctz64(rook_pin);
-            uint64_t moveableSquares = rookMoveableSquare(from);
+            uint64_t moveableSquares = rookMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares & pinHV;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), ROOK, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             rook_pin &= rook_pin - 1;
@@ -924,11 +764,11 @@ public:
         // Bishop not pinned
         while (bishop_nopin){
             uint8_t from = ctz64(bishop_nopin);
-            uint64_t moveableSquares = bishopMoveableSquare(from);
+            uint64_t moveableSquares = bishopMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), BISHOP, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             bishop_nopin &= bishop_nopin - 1;
@@ -936,11 +776,11 @@ public:
         // Bishop pinned
         while (bishop_pin){
             uint8_t from = ctz64(bishop_pin);
-            uint64_t moveableSquares = bishopMoveableSquare(from);
+            uint64_t moveableSquares = bishopMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares & pinD12;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), BISHOP, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             bishop_pin &= bishop_pin - 1;
@@ -948,11 +788,11 @@ public:
 
         while (queen_nopin){
             uint8_t from = ctz64(queen_nopin);
-            uint64_t moveableSquares = queenMoveableSquare(from);
+            uint64_t moveableSquares = queenMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), QUEEN, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             queen_nopin &= queen_nopin - 1;
@@ -960,11 +800,11 @@ public:
 
         while (queen_pinHV){
             uint8_t from = ctz64(queen_pinHV);
-            uint64_t moveableSquares = rookMoveableSquare(from);
+            uint64_t moveableSquares = rookMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares & pinHV;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), QUEEN, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             queen_pinHV &= queen_pinHV - 1;
@@ -972,11 +812,11 @@ public:
 
         while (queen_pinD12){
             uint8_t from = ctz64(queen_pinD12);
-            uint64_t moveableSquares = bishopMoveableSquare(from);
+            uint64_t moveableSquares = bishopMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares & pinD12;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), QUEEN, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             queen_pinD12 &= queen_pinD12 - 1;
@@ -984,450 +824,772 @@ public:
 
         while (knight){
             uint8_t from = ctz64(knight);
-            uint64_t moveableSquares = knightMoveableSquare(from);
+            uint64_t moveableSquares = knightMoveableSquare<White>(from);
             uint64_t legal_squares = moveableSquares & checkedSquares;
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), KNIGHT, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
             knight &= knight - 1;
         }
 
-        while (king){
-            uint8_t from = ctz64(king);
-            uint64_t moveableSquares = kingMoveableSquare(from);
-            uint64_t legal_squares = moveableSquares & ~seenSquares; // king cant move into seen squares
+        while (king_bb){
+            uint8_t from = ctz64(king_bb);
+            uint64_t moveableSquares = kingMoveableSquare<White>(from);
+            uint64_t legal_squares = moveableSquares & ~seenSquares & targets; // king cant move into seen squares
             while (legal_squares){
                 uint8_t to = ctz64(legal_squares);
-                allLegalMoves.emplace_back((from & 0x3F) | ((to & 0x3F) << 6));
+                allLegalMoves.add((from & 0x3F) | ((to & 0x3F) << 6), KING, mailbox[to], MOVE_NORMAL);
                 legal_squares &= legal_squares - 1;
             }
-            king &= king - 1;
+            king_bb &= king_bb - 1;
         }
 
         return allLegalMoves;
     };
+    // generateMoves while in check. Only the king can get out of a double check, a single check can also be
+    // blocked or its checker captured, but never by a pinned piece (it would have to leave its pin ray), and castling is out.
+    template<bool White, typename List = MoveList, int Gen = GEN_ALL>
+    inline List generateEvasions(const AttackInfo& info) {
+        List evasions;
+        constexpr uint64_t promotionRank = White ? RANK_8 : RANK_1;
+        uint64_t targets = Gen == GEN_ALL ? ~0ULL : Gen == GEN_CAPTURES ? pieces<!White>() : ~allOccupied;
+
+        uint8_t kingSquare = ctz64(king<White>());
+        uint64_t kingSquares = kingMoveableSquare<White>(kingSquare) & ~info.seenSquares & targets; // king cant move into seen squares
+        while (kingSquares){
+            uint8_t to = ctz64(kingSquares);
+            evasions.add((kingSquare & 0x3F) | ((to & 0x3F) << 6), KING, mailbox[to], MOVE_NORMAL);
+            kingSquares &= kingSquares - 1;
+        }
+        if (info.checkers & (info.checkers - 1)) return evasions; // double check
+
+        uint64_t movers = pieces<White>() & ~(info.pinHV | info.pinD12);
+        uint64_t blockSquares = info.checkMask & targets; // squares between the slider and the king, and the checker
+        uint64_t pawnSquares = info.checkMask & (Gen == GEN_ALL ? ~0ULL : Gen == GEN_CAPTURES ? pieces<!White>() | promotionRank : ~allOccupied & ~promotionRank);
+
+        // en passant, either the double pushed pawn is the checker or the capture blocks
+        if (Gen != GEN_QUIETS){
+            uint8_t enPassantSquare = White ? enPassantFile + 40 : enPassantFile + 16;
+            for (uint64_t capturers = enPassantCapturers<White>(info); capturers; capturers &= capturers - 1){
+                evasions.add((ctz64(capturers) & 0x3F) | ((enPassantSquare & 0x3F) << 6), PAWN, PAWN, MOVE_EN_PASSANT);
+            }
+        }
+
+        addPawnMoves<White>(evasions, pawnTargets<White>(info.pinHV, info.pinD12, pawnSquares)); // pinned pawns find no square
+        for (uint64_t bb = knights<White>() & movers; bb; bb &= bb - 1){
+            uint8_t from = ctz64(bb);
+            for (uint64_t legal_squares = knightMoveableSquare<White>(from) & blockSquares; legal_squares; legal_squares &= legal_squares - 1){
+                uint8_t to = ctz64(legal_squares);
+                evasions.add((from & 0x3F) | ((to & 0x3F) << 6), KNIGHT, mailbox[to], MOVE_NORMAL);
+            }
+        }
+        for (uint64_t bb = bishops<White>() & movers; bb; bb &= bb - 1){
+            uint8_t from = ctz64(bb);
+            for (uint64_t legal_squares = bishopMoveableSquare<White>(from) & blockSquares; legal_squares; legal_squares &= legal_squares - 1){
+                uint8_t to = ctz64(legal_squares);
+                evasions.add((from & 0x3F) | ((to & 0x3F) << 6), BISHOP, mailbox[to], MOVE_NORMAL);
+            }
+        }
+        for (uint64_t bb = rooks<White>() & movers; bb; bb &= bb - 1){
+            uint8_t from = ctz64(bb);
+            for (uint64_t legal_squares = rookMoveableSquare<White>(from) & blockSquares; legal_squares; legal_squares &= legal_squares - 1){
+                uint8_t to = ctz64(legal_squares);
+                evasions.add((from & 0x3F) | ((to & 0x3F) << 6), ROOK, mailbox[to], MOVE_NORMAL);
+            }
+        }
+        for (uint64_t bb = queens<White>() & movers; bb; bb &= bb - 1){
+            uint8_t from = ctz64(bb);
+            for (uint64_t legal_squares = queenMoveableSquare<White>(from) & blockSquares; legal_squares; legal_squares &= legal_squares - 1){
+                uint8_t to = ctz64(legal_squares);
+                evasions.add((from & 0x3F) | ((to & 0x3F) << 6), QUEEN, mailbox[to], MOVE_NORMAL);
+            }
+        }
+        return evasions;
+    };
     
-    // Move execution
-    inline void makeMove(uint16_t move){
+    inline MoveList generateAllLegalMoves() {
+        return whiteToMove ? generateMoves<true>() : generateMoves<false>();
+    };
+    inline MoveRecordList generateAllLegalMoveRecords() {
+        return whiteToMove ? generateMoves<true, MoveRecordList>() : generateMoves<false, MoveRecordList>();
+    };
+    // the stages of the search's move picker, together they are generateAllLegalMoveRecords
+    inline MoveRecordList generateCaptureRecords() {
+        return whiteToMove ? generateMoves<true, MoveRecordList, GEN_CAPTURES>() : generateMoves<false, MoveRecordList, GEN_CAPTURES>();
+    };
+    inline MoveRecordList generateQuietRecords() {
+        return whiteToMove ? generateMoves<true, MoveRecordList, GEN_QUIETS>() : generateMoves<false, MoveRecordList, GEN_QUIETS>();
+    };
+    // Is move one that generateMoves<White> would produce in this position. For TT and killer moves, which can come
+    // from another position, so the search can play them before generating anything. The masks are the ones of generateMoves.
+    template<bool White>
+    inline bool isLegal(uint16_t move) {
         uint8_t from = move & 0x3F;
         uint8_t to = (move >> 6) & 0x3F;
-        uint64_t fromMask = 1Ull << from;
+        uint64_t fromMask = 1ULL << from;
         uint64_t toMask = 1ULL << to;
-        uint64_t fromToMask = fromMask ^ toMask;
-        uint8_t movedPiece = getPieceOfSquare(from);
-        uint8_t capturedPiece = getPieceOfSquare(to);
-        uint8_t enPassantFile = enPassantFileHistory[plycount];
-        uint8_t castlingRights = castlingRightHistory[plycount];
-
-        // Update bitboards //
-        if (whiteToMove){
-            // Move the piece
-            whitePieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: whitePawns ^= fromToMask; break;
-                case 2: whiteKnights ^= fromToMask; break;
-                case 3: whiteBishops ^= fromToMask; break;
-                case 4: whiteRooks ^= fromToMask; break;
-                case 5: whiteQueens ^= fromToMask; break;
-                case 6: whiteKing ^= fromToMask; break;
+        if (move == 0 || !(pieces<White>() & fromMask)) return false;
+        const AttackInfo& info = getAttackInfo<White>();
+        uint8_t piece = mailbox[from];
+        bool castling = (move >> 12) & 0x1;
+        bool promotion = (move >> 15) & 0x1;
+
+        if (castling){
+            if (piece != KING || promotion || (move >> 13) & 0x3 || info.checkMask != 0xFFFFFFFFFFFFFFFFULL) return false;
+            if (White){
+                if (from == 4 && to == 6) return (castlingRights & 8) && (pieceBB[WHITE][ROOK] & (1ULL << 7)) && !(info.seenSquares & WKS_SEEN) && !(allOccupied & WKS_OCC);
+                if (from == 4 && to == 2) return (castlingRights & 4) && (pieceBB[WHITE][ROOK] & (1ULL << 0)) && !(info.seenSquares & WQS_SEEN) && !(allOccupied & WQS_OCC);
+            } else{
+                if (from == 60 && to == 62) return (castlingRights & 2) && (pieceBB[BLACK][ROOK] & (1ULL << 63)) && !(info.seenSquares & BKS_SEEN) && !(allOccupied & BKS_OCC);
+                if (from == 60 && to == 58) return (castlingRights & 1) && (pieceBB[BLACK][ROOK] & (1ULL << 56)) && !(info.seenSquares & BQS_SEEN) && !(allOccupied & BQS_OCC);
             }
-            
-            // Handle en passant Capture
-            if ((movedPiece == 1) && (enPassantFile != 0xFF) && (to == (enPassantFile + 40))) {
-                // if a pawn goes to the en passant square -> then en passant capture 
-                // en passant is happening
-                // clear black pawn one rank down
-                blackPawns &= ~(1ULL << (enPassantFile + 32));
-                blackPieces &= ~(1ULL << (enPassantFile + 32));
-            } 
-            // Handle normal captures
-            else if (capturedPiece != 0){
-                blackPieces &= ~toMask;
-                switch (capturedPiece) {
-                    case 1: blackPawns &= ~toMask; break;
-                    case 2: blackKnights &= ~toMask; break;
-                    case 3: blackBishops &= ~toMask; break;
-                    case 4: blackRooks &= ~toMask; break;
-                    case 5: blackQueens &= ~toMask; break;
-                    case 6: blackKing &= ~toMask; break;
+            return false;
+        }
+        // only promotions carry a promotion piece, and every pawn move to the last rank is one
+        bool toLastRank = toMask & (White ? RANK_8 : RANK_1);
+        if (promotion != (piece == PAWN && toLastRank) || (!promotion && ((move >> 13) & 0x3))) return false;
+
+        uint64_t pinHV = info.pinHV;
+        uint64_t pinD12 = info.pinD12;
+        uint64_t legal_squares = 0;
+        switch (piece){
+            case PAWN:
+                if (enPassantFile != 0xFF && to == enPassantFile + (White ? 40 : 16)){
+                    return enPassantCapturers<White>(info) & fromMask;
                 }
+                legal_squares = pawnMoveableSquare<White>(from) & info.checkMask;
+                if (fromMask & pinHV) legal_squares &= pinHV;
+                else if (fromMask & pinD12) legal_squares &= pinD12;
+                break;
+            case KNIGHT:
+                if (!(fromMask & (pinHV | pinD12))) legal_squares = knightMoveableSquare<White>(from) & info.checkMask;
+                break;
+            case BISHOP:
+                if (!(fromMask & (pinHV | pinD12))) legal_squares = bishopMoveableSquare<White>(from) & info.checkMask;
+                else if (fromMask & pinD12) legal_squares = bishopMoveableSquare<White>(from) & info.checkMask & pinD12;
+                break;
+            case ROOK:
+                if (!(fromMask & (pinHV | pinD12))) legal_squares = rookMoveableSquare<White>(from) & info.checkMask;
+                else if (fromMask & pinHV) legal_squares = rookMoveableSquare<White>(from) & info.checkMask & pinHV;
+                break;
+            case QUEEN:
+                if (!(fromMask & (pinHV | pinD12))) legal_squares = queenMoveableSquare<White>(from) & info.checkMask;
+                else if (fromMask & pinHV) legal_squares = rookMoveableSquare<White>(from) & info.checkMask & pinHV;
+                else legal_squares = bishopMoveableSquare<White>(from) & info.checkMask & pinD12;
+                break;
+            case KING:
+                legal_squares = kingMoveableSquare<White>(from) & ~info.seenSquares;
+                break;
+        }
+        return legal_squares & toMask;
+    }
+    inline bool isLegal(uint16_t move) {
+        return whiteToMove ? isLegal<true>(move) : isLegal<false>(move);
+    }
+    // count the legal moves for the side White without writing them to a list,
+    // the masks are the same as in generateMoves but the destination squares are only popcounted
+    template<bool White>
+    inline int countMoves() {
+        const AttackInfo& info = getAttackInfo<White>();
+        if (info.checkers) return countEvasions<White>(info);
+        uint64_t seenSquares = info.seenSquares;
+        uint64_t checkedSquares = info.checkMask;
+        uint64_t pinHV = info.pinHV;
+        uint64_t pinD12 = info.pinD12;
+        uint64_t allPins = pinHV | pinD12;
+        int count = 0;
+
+        // en passant, a pawn on either side of the double pushed pawn can capture it unless that uncovers a check
+        count += popcount64(enPassantCapturers<White>(info));
+
+        // castling, same conditions as in generateMoves
+        if (checkedSquares == 0xFFFFFFFFFFFFFFFFULL){
+            if (White){
+                count += (castlingRights & 8) && (pieceBB[WHITE][ROOK] & (1ULL << 7)) && !(seenSquares & WKS_SEEN) && !(allOccupied & WKS_OCC);
+                count += (castlingRights & 4) && (pieceBB[WHITE][ROOK] & (1ULL << 0)) && !(seenSquares & WQS_SEEN) && !(allOccupied & WQS_OCC);
+            } else{
+                count += (castlingRights & 2) && (pieceBB[BLACK][ROOK] & (1ULL << 63)) && !(seenSquares & BKS_SEEN) && !(allOccupied & BKS_OCC);
+                count += (castlingRights & 1) && (pieceBB[BLACK][ROOK] & (1ULL << 56)) && !(seenSquares & BQS_SEEN) && !(allOccupied & BQS_OCC);
             }
-        } else { // Black's move
-            // Move the piece
-            blackPieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: blackPawns ^= fromToMask; break;
-                case 2: blackKnights ^= fromToMask; break;
-                case 3: blackBishops ^= fromToMask; break;
-                case 4: blackRooks ^= fromToMask; break;
-                case 5: blackQueens ^= fromToMask; break;
-                case 6: blackKing ^= fromToMask; break;
+        }
+
+        // pawns, a move onto the last rank is four moves (one per promotion piece)
+        count += countPawnMoves<White>(pawnTargets<White>(pinHV, pinD12, checkedSquares));
+
+        // sliders, a pinned piece can only move along its pin ray
+        for (uint64_t bb = rooks<White>() & ~allPins; bb; bb &= bb - 1)
+            count += popcount64(rookMoveableSquare<White>(ctz64(bb)) & checkedSquares);
+        for (uint64_t bb = (rooks<White>() | queens<White>()) & pinHV; bb; bb &= bb - 1)
+            count += popcount64(rookMoveableSquare<White>(ctz64(bb)) & checkedSquares & pinHV);
+        for (uint64_t bb = bishops<White>() & ~allPins; bb; bb &= bb - 1)
+            count += popcount64(bishopMoveableSquare<White>(ctz64(bb)) & checkedSquares);
+        for (uint64_t bb = (bishops<White>() | queens<White>()) & pinD12; bb; bb &= bb - 1)
+            count += popcount64(bishopMoveableSquare<White>(ctz64(bb)) & checkedSquares & pinD12);
+        for (uint64_t bb = queens<White>() & ~allPins; bb; bb &= bb - 1)
+            count += popcount64(queenMoveableSquare<White>(ctz64(bb)) & checkedSquares);
+
+        // a pinned knight can never move
+        for (uint64_t bb = knights<White>() & ~allPins; bb; bb &= bb - 1)
+            count += popcount64(knightMoveableSquare<White>(ctz64(bb)) & checkedSquares);
+
+        count += popcount64(kingMoveableSquare<White>(ctz64(king<White>())) & ~seenSquares); // king cant move into seen squares
+        return count;
+    };
+    // countMoves while in check, the moves of generateEvasions
+    template<bool White>
+    inline int countEvasions(const AttackInfo& info) {
+        int count = popcount64(kingMoveableSquare<White>(ctz64(king<White>())) & ~info.seenSquares);
+        if (info.checkers & (info.checkers - 1)) return count; // double check
+
+        uint64_t movers = pieces<White>() & ~(info.pinHV | info.pinD12);
+        uint64_t blockSquares = info.checkMask;
+        count += popcount64(enPassantCapturers<White>(info));
+        count += countPawnMoves<White>(pawnTargets<White>(info.pinHV, info.pinD12, blockSquares));
+        for (uint64_t bb = knights<White>() & movers; bb; bb &= bb - 1)
+            count += popcount64(knightMoveableSquare<White>(ctz64(bb)) & blockSquares);
+        for (uint64_t bb = bishops<White>() & movers; bb; bb &= bb - 1)
+            count += popcount64(bishopMoveableSquare<White>(ctz64(bb)) & blockSquares);
+        for (uint64_t bb = rooks<White>() & movers; bb; bb &= bb - 1)
+            count += popcount64(rookMoveableSquare<White>(ctz64(bb)) & blockSquares);
+        for (uint64_t bb = queens<White>() & movers; bb; bb &= bb - 1)
+            count += popcount64(queenMoveableSquare<White>(ctz64(bb)) & blockSquares);
+        return count;
+    };
+    inline int countAllLegalMoves() {
+        return whiteToMove ? countMoves<true>() : countMoves<false>();
+    };
+
+    // Perft
+    // number of leaf nodes of the legal move tree below the current position.
+    // With bulk the last ply is counted with countMoves instead of being played out.
+    // CopyMake takes the moves back by restoring a Snapshot of the node instead of undoMove.
+    template<bool White, bool CopyMake = COPY_MAKE>
+    inline uint64_t perftNodes(int depth, bool bulk) {
+        if (depth == 0) return 1;
+        if (bulk && depth == 1) return countMoves<White>();
+        uint64_t nodes = 0;
+        MoveRecordList moves = generateMoves<White, MoveRecordList>();
+        if constexpr (CopyMake) {
+            Snapshot before;
+            save(before);
+            for (const MoveRecord& move : moves) {
+                doMove<White>(move);
+                nodes += perftNodes<!White, true>(depth - 1, bulk);
+                restore(before);
             }
-            // Handle en passant Capture
-            if ((movedPiece == 1) && (enPassantFile != 0xFF) && (to == enPassantFile + 16)) {
-                // if a pawn goes to the en passant square -> then en passant capture 
-                // en passant is happening
-                // clear black pawn one rank up
-                whitePawns &= ~(1ULL << (enPassantFile + 24));
-                whitePieces &= ~(1ULL << (enPassantFile + 24));
-            } 
-            // Handle normal captures
-            else if (capturedPiece != 0){
-                whitePieces &= ~toMask;
-                switch (capturedPiece) {
-                    case 1: whitePawns &= ~toMask; break;
-                    case 2: whiteKnights &= ~toMask; break;
-                    case 3: whiteBishops &= ~toMask; break;
-                    case 4: whiteRooks &= ~toMask; break;
-                    case 5: whiteQueens &= ~toMask; break;
-                    case 6: whiteKing &= ~toMask; break;
-                }
+        } else {
+            for (const MoveRecord& move : moves) {
+                doMove<White>(move);
+                nodes += perftNodes<!White, false>(depth - 1, bulk);
+                undoMove<White>();
             }
         }
-         // Handle promotion
-        if ((move >> 15) & 0x1){
-            // no need to adjust whitePieces or blackPieces
-            if (whiteToMove){
-                whitePawns &= ~toMask; // clear Pawn from promotion square
-                switch ((move >> 13) & 0x3){
-                    case 3: whiteQueens  |= toMask; break;
-                    case 2: whiteRooks   |= toMask; break;
-                    case 1: whiteBishops |= toMask; break;
-                    case 0: whiteKnights |= toMask; break;
-                }
-            } else{
-                blackPawns &= ~toMask; // clear pawn from promotion square
-                switch ((move >> 13) & 0x3) {
-                    case 3: blackQueens |= toMask; break;
-                    case 2: blackRooks |= toMask; break;
-                    case 1: blackBishops |= toMask; break;
-                    case 0: blackKnights |= toMask; break;
+        return nodes;
+    };
+    uint64_t perft(int depth, bool bulk = true) {
+        return whiteToMove ? perftNodes<true>(depth, bulk) : perftNodes<false>(depth, bulk);
+    };
+    
+    // Move execution
+    // doMove/undoMove are specialized on the color that makes the move,
+    // makeMove/unmakeMove dispatch on whiteToMove for callers that don't track the side themselves.
+    template<bool White>
+    inline void doMove(const MoveRecord& record){
+        constexpr int us = White ? WHITE : BLACK;
+        constexpr int them = White ? BLACK : WHITE;
+        uint16_t move = record.move;
+        uint8_t from = move & 0x3F;
+        uint8_t to = (move >> 6) & 0x3F;
+        uint64_t fromMask = 1Ull << from;
+        uint64_t toMask = 1ULL << to;
+        uint64_t fromToMask = fromMask ^ toMask;
+        uint8_t movedPiece = record.piece;
+        uint8_t capturedPiece = record.captured;
+        // Zobrist key is updated incrementally, start by moving the piece from -> to
+        uint64_t key = zobristKey ^ pieceKey(movedPiece, White, from) ^ pieceKey(movedPiece, White, to);
+        mailbox[from] = 0;
+        mailbox[to] = movedPiece;
+
+        // Update bitboards //
+        // Move the piece
+        pieceBB[us][ALL] ^= fromToMask;
+        pieceBB[us][movedPiece] ^= fromToMask;
+        enPassantFile = 0xFF;
+
+        switch (record.type){
+            case MOVE_NORMAL:
+                if (capturedPiece != 0){
+                    key ^= pieceKey(capturedPiece, !White, to);
+                    pieceBB[them][ALL] &= ~toMask;
+                    pieceBB[them][capturedPiece] &= ~toMask;
                 }
+                break;
+            case MOVE_DOUBLE_PUSH:
+                enPassantFile = to % 8;
+                break;
+            case MOVE_EN_PASSANT: {
+                // clear the enemy pawn one rank behind the en passant square
+                uint8_t capturedPawnSquare = White ? to - 8 : to + 8;
+                pieceBB[them][PAWN] &= ~(1ULL << capturedPawnSquare);
+                pieceBB[them][ALL] &= ~(1ULL << capturedPawnSquare);
+                key ^= pieceKey(PAWN, !White, capturedPawnSquare);
+                mailbox[capturedPawnSquare] = 0;
+                break;
             }
-        }
-        // Handle castling
-        if (movedPiece == 6){
-            if (std::abs(static_cast<int>(from) - static_cast<int>(to)) == 2){
-                switch (to){
-                    case 6: // white king side
-                        whiteRooks &= ~(1ULL << 7); // set 7th bit to zero
-                        whiteRooks |= (1ULL << 5); // set 5th bit to one
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 7);
-                        whitePieces |= (1ULL << 5);
-                        // set first two bits of castlingRights to zero
-                        castlingRights &= ~(0x8);
-                        castlingRights &= ~(0x4);
-                        break;
-                    case 2: // white queen side
-                        whiteRooks &= ~(1ULL << 0); // set 0th bit to zero
-                        whiteRooks |= (1ULL << 3); // set 3th bit to one
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 0);
-                        whitePieces |= (1ULL << 3);
-                        // set first two bits of castlingRights to zero
-                        castlingRights &= ~(0x8);
-                        castlingRights &= ~(0x4);
-                        break;
-                    case 62: // black king side
-                        blackRooks &= ~(1ULL << 63); // set 63th bit to zero
-                        blackRooks |= (1ULL << 61); // set 59th bit to one
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 63);
-                        blackPieces |= (1ULL << 61);
-                        // set last two bits of castlingRights to zero
-                        castlingRights &= ~(0x2);
-                        castlingRights &= ~(0x1);
-                        break;
-                    case 58: // black queen side
-                        blackRooks &= ~(1ULL << 56); // set 56th bit to zero
-                        blackRooks |= (1ULL << 59); // set 59th bit to one
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 56);
-                        blackPieces |= (1ULL << 59);
-                        // set last two bits of castlingRights to zero
-                        castlingRights &= ~(0x2);
-                        castlingRights &= ~(0x1);
-                        break;
-                }
-            } else{ // only king move -> only update castling rights
-                if (whiteToMove){
-                    castlingRights &= ~(0x8);
-                    castlingRights &= ~(0x4);
-                } else{
-                    castlingRights &= ~(0x2);
-                    castlingRights &= ~(0x1);
+            case MOVE_PROMOTION: {
+                if (capturedPiece != 0){
+                    key ^= pieceKey(capturedPiece, !White, to);
+                    pieceBB[them][ALL] &= ~toMask;
+                    pieceBB[them][capturedPiece] &= ~toMask;
                 }
+                // swap the pawn for the promoted piece (knight = 2 ... queen = 5)
+                uint8_t promotedPiece = ((move >> 13) & 0x3) + 2;
+                key ^= pieceKey(PAWN, White, to) ^ pieceKey(promotedPiece, White, to);
+                mailbox[to] = promotedPiece;
+                // no need to adjust the color bitboards
+                pieceBB[us][PAWN] &= ~toMask; // clear Pawn from promotion square
+                pieceBB[us][promotedPiece] |= toMask;
+                break;
             }
-        }
-        if (movedPiece == 4){ // if rook has moved set castling rights
-            switch (from){ // see where the rook has moved from
-                case 7: // white king side
-                    castlingRights &= ~(0x8);
-                    break;
-                case 0: // white queen side
-                    // set second bit to zero
-                    castlingRights &= ~(0x4);
-                    break;
-                case 63: // black king side
-                    // set third bit to zero
-                    castlingRights &= ~(0x2);
-                    break;
-                case 56: // black queen side
-                    // set fourth bit to zero
-                    castlingRights &= ~(0x1);
-                    break;
+            case MOVE_CASTLING: {
+                // the rook jumps over the king, h -> f or a -> d
+                uint8_t rookFrom = to > from ? to + 1 : to - 2;
+                uint8_t rookTo = to > from ? to - 1 : to + 1;
+                uint64_t rookMask = (1ULL << rookFrom) | (1ULL << rookTo);
+                pieceBB[us][ROOK] ^= rookMask;
+                pieceBB[us][ALL] ^= rookMask;
+                key ^= pieceKey(ROOK, White, rookFrom) ^ pieceKey(ROOK, White, rookTo);
+                mailbox[rookFrom] = 0;
+                mailbox[rookTo] = ROOK;
+                break;
             }
         }
-        // modifiy enPassantFile
-        enPassantFile = 0xFF;
-        if (movedPiece == 1){
-            if (whiteToMove ? (to-from == 16) : (from-to == 16)){
-                enPassantFile = to%8;
+
+        // a king move gives up both castling rights of its side, a rook move the one of its corner
+        if (movedPiece == KING){
+            castlingRights &= White ? ~0xC : ~0x3;
+        } else if (movedPiece == ROOK){
+            switch (from){
+                case 7: castlingRights &= ~0x8; break; // white king side
+                case 0: castlingRights &= ~0x4; break; // white queen side
+                case 63: castlingRights &= ~0x2; break; // black king side
+                case 56: castlingRights &= ~0x1; break; // black queen side
             }
         }
-        
+
         // Set all Pieces
-        allOccupied = whitePieces | blackPieces;
+        allOccupied = pieceBB[WHITE][ALL] | pieceBB[BLACK][ALL];
+
+        // castling rights, en passant file and side to move deltas
+        // the top of the history still holds the state before the move
+        const UndoRecord& previous = history.back();
+        key ^= ZOBRIST.castlingHash[previous.castlingRights] ^ ZOBRIST.castlingHash[castlingRights];
+        if (previous.enPassantFile != 0xFF) key ^= ZOBRIST.enPassantHash[previous.enPassantFile];
+        if (enPassantFile != 0xFF) key ^= ZOBRIST.enPassantHash[enPassantFile];
+        key ^= ZOBRIST.whiteToMoveHash;
 
         // Update game state information //
         plycount++;
-        whiteToMove = !whiteToMove;
-        moveHistory[plycount] = move;
-        capturedPieceHistory[plycount] = capturedPiece;  // save captured Piece
-        castlingRightHistory[plycount] = castlingRights; // save modified castling right
-        enPassantFileHistory[plycount] = enPassantFile;  // save modified enPassant file
-        uint8_t halfMoveValue = (capturedPiece || movedPiece == 1) ? 0 : halfmoveClockHistory[plycount - 1] + 1;
-        halfmoveClockHistory[plycount] = halfMoveValue; // save current halfmoveValue to halfmoveClockHistory
-        zobristKey = getZobristKey();
-        zobristKeyHistory[plycount] = zobristKey; // save zobristKey to history
-        if (whiteToMove) fullmoveNumber++;
+        whiteToMove = !White;
+        attackInfoValid = 0;
+        halfmoveClock = (capturedPiece || movedPiece == PAWN) ? 0 : halfmoveClock + 1;
+        zobristKey = key;
+        history.push(move, capturedPiece, castlingRights, enPassantFile, halfmoveClock, zobristKey, record.type);
+        if (!White) fullmoveNumber++;
+#ifdef WOKFISCH_DEBUG
+        assert(zobristKey == getZobristKey() && "incremental zobrist key diverged from full recomputation");
+#endif
     };
-    inline void unmakeMove(){
-        if (plycount == 0) return;  // No moves to undo
-
-        uint16_t move = moveHistory[plycount]; // decrease plycount
+    // a 16 bit move, its pieces and type are looked up on the board first
+    template<bool White>
+    inline void doMove(uint16_t move){
+        doMove<White>(moveRecord<White>(move));
+    };
+    // the MoveRecord the move generator would have produced for move
+    template<bool White>
+    inline MoveRecord moveRecord(uint16_t move) const {
+        uint8_t from = move & 0x3F;
+        uint8_t to = (move >> 6) & 0x3F;
+        MoveRecord record = {move, mailbox[from], mailbox[to], MOVE_NORMAL};
+        if ((move >> 15) & 0x1){
+            record.type = MOVE_PROMOTION;
+        } else if (record.piece == KING && (from - to == 2 || to - from == 2)){
+            record.type = MOVE_CASTLING;
+        } else if (record.piece == PAWN){
+            if (White ? to - from == 16 : from - to == 16){
+                record.type = MOVE_DOUBLE_PUSH;
+            } else if (enPassantFile != 0xFF && to == enPassantFile + (White ? 40 : 16)){
+                record.type = MOVE_EN_PASSANT;
+                record.captured = PAWN;
+            }
+        }
+        return record;
+    }
+    inline MoveRecord moveRecord(uint16_t move) const {
+        return whiteToMove ? moveRecord<true>(move) : moveRecord<false>(move);
+    };
+    inline void makeMove(uint16_t move){
+        whiteToMove ? doMove<true>(move) : doMove<false>(move);
+    };
+    inline void makeMove(const MoveRecord& record){
+        whiteToMove ? doMove<true>(record) : doMove<false>(record);
+    };
+    template<bool White>
+    inline void undoMove(){
+        constexpr int us = White ? WHITE : BLACK;
+        constexpr int them = White ? BLACK : WHITE;
+        const UndoRecord& last = history.back();
+        uint16_t move = last.move;
+        uint8_t capturedPiece = last.capturedPiece;
+        uint8_t moveType = last.moveType;
 
         uint8_t from = move & 0x3F;
         uint8_t to = (move >> 6) & 0x3F;
         uint64_t fromMask = 1Ull << from;
         uint64_t toMask = 1ULL << to;
         uint64_t fromToMask = fromMask ^ toMask;
-        uint8_t movedPiece = getPieceOfSquare(to);
-        uint8_t capturedPiece = capturedPieceHistory[plycount];
-        uint8_t enPassantFile = enPassantFileHistory[plycount-1]; // get enPassantfile from last move
-        uint8_t castlingRights = castlingRightHistory[plycount];
-       
+        uint8_t movedPiece = mailbox[to]; // the promoted piece for promotions
+        // drop the record of the move and restore the irreversible state of the previous position
+        history.pop();
+        const UndoRecord& previous = history.back();
+        castlingRights = previous.castlingRights;
+        enPassantFile = previous.enPassantFile;
+        halfmoveClock = previous.halfmoveClock;
+        zobristKey = previous.zobristKey;
+
         // Update bitboards //
-        // We're undoing the last move, so the current turn is opposite of the move we're undoing
-        if (whiteToMove){
-            // Move the piece back
-            blackPieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: blackPawns ^= fromToMask; break;
-                case 2: blackKnights ^= fromToMask; break;
-                case 3: blackBishops ^= fromToMask; break;
-                case 4: blackRooks ^= fromToMask; break;
-                case 5: blackQueens ^= fromToMask; break;
-                case 6: blackKing ^= fromToMask; break;
-            }
-            
-            // Handle en passant Capture
-            // We have moved a pawn and en passant file was set
-            if ((movedPiece == 1) && (enPassantFile != 0xFF) && (to == enPassantFile + 16)) {
-                // if pawn has moved to the en passant square -> then en passant capture happened
-                // en passant has happened
-                // restore white pawn one file up
-                whitePawns |= (1ULL << (enPassantFile + 24));
-                whitePieces |= (1ULL << (enPassantFile + 24));
-            }
-            // Handle normal captures
-            else if (capturedPiece != 0){
-                whitePieces |= toMask;
-                switch (capturedPiece) {
-                    case 1: whitePawns |= toMask; break;
-                    case 2: whiteKnights |= toMask; break;
-                    case 3: whiteBishops |= toMask; break;
-                    case 4: whiteRooks |= toMask; break;
-                    case 5: whiteQueens |= toMask; break;
-                    case 6: whiteKing |= toMask; break;
+        // White is the color that made the move we're undoing
+        // Move the piece back
+        pieceBB[us][ALL] ^= fromToMask;
+        pieceBB[us][movedPiece] ^= fromToMask;
+        mailbox[from] = movedPiece;
+        mailbox[to] = 0;
+
+        switch (moveType){
+            case MOVE_NORMAL:
+                if (capturedPiece != 0){
+                    pieceBB[them][ALL] |= toMask;
+                    pieceBB[them][capturedPiece] |= toMask;
+                    mailbox[to] = capturedPiece;
                 }
+                break;
+            case MOVE_DOUBLE_PUSH:
+                break;
+            case MOVE_EN_PASSANT: {
+                // restore the enemy pawn one rank behind the en passant square
+                uint8_t capturedPawnSquare = White ? to - 8 : to + 8;
+                pieceBB[them][PAWN] |= (1ULL << capturedPawnSquare);
+                pieceBB[them][ALL] |= (1ULL << capturedPawnSquare);
+                mailbox[capturedPawnSquare] = PAWN;
+                break;
             }
-        } else{ // remove black move
-            // Move the piece back
-            whitePieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: whitePawns ^= fromToMask; break;
-                case 2: whiteKnights ^= fromToMask; break;
-                case 3: whiteBishops ^= fromToMask; break;
-                case 4: whiteRooks ^= fromToMask; break;
-                case 5: whiteQueens ^= fromToMask; break;
-                case 6: whiteKing ^= fromToMask; break;
-            }
-            
-            // Handle en passant Capture
-            // We have moved a pawn and en passant file was set
-            if ((movedPiece == 1) && (enPassantFile != 0xFF) && (to == enPassantFile + 40)) {
-                // if pawn has moved to the en passant square -> then en passant capture happened
-                // en passant has happened
-                // restore white pawn one file up
-                blackPawns |= (1ULL << (enPassantFile + 32));
-                blackPieces |= (1ULL << (enPassantFile + 32));
-            }
-            // Handle normal captures
-            else if (capturedPiece != 0){
-                // printBitboard(blackPawns);
-                blackPieces |= toMask;
-                switch (capturedPiece) {
-                    case 1: blackPawns |= toMask; break;
-                    case 2: blackKnights |= toMask; break;
-                    case 3: blackBishops |= toMask; break;
-                    case 4: blackRooks |= toMask; break;
-                    case 5: blackQueens |= toMask; break;
-                    case 6: blackKing |= toMask; break;
-                }
-            }
-        }
-        // Handle promotion
-        if ((move >> 15) & 0x1){
-            // no need to adjust whitePieces or blackPieces
-            if (!whiteToMove){ // undoing white move
-                whitePawns |= fromMask; 
-                switch ((move >> 13) & 0x3) {
-                    case 0: whiteKnights &= ~fromMask; break;
-                    case 1: whiteBishops &= ~fromMask; break;
-                    case 2: whiteRooks &= ~fromMask; break;
-                    case 3: whiteQueens &= ~fromMask; break;
-                }
-            } else{
-                blackPawns |= fromMask;
-                switch ((move >> 13) & 0x3) {
-                    case 0: blackKnights &= ~fromMask; break;
-                    case 1: blackBishops &= ~fromMask; break;
-                    case 2: blackRooks &= ~fromMask; break;
-                    case 3: blackQueens &= ~fromMask; break;
-                }
-            }
-        }
-        // Handle castling
-        if (movedPiece == 6){
-            // if castling happened
-            if (std::abs(static_cast<int>(from) - static_cast<int>(to)) == 2){
-                switch (to) { // see where the king has moved to
-                    case 6: // white king side
-                        whiteRooks &= ~(1ULL << 5); // set 5th bit to zero
-                        whiteRooks |= (1ULL << 7); // set 7th bit to one
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 5);
-                        whitePieces |= (1ULL << 7);
-                        break;
-                    case 2: // white queen side
-                        whiteRooks &= ~(1ULL << 3); // set 3rd bit to zero
-                        whiteRooks |= (1ULL << 0); // set 0th bit to one
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 3);
-                        whitePieces |= (1ULL << 0);
-                        break;
-                    case 62: // black king side
-                        blackRooks &= ~(1ULL << 61); // set 61th bit to zero
-                        blackRooks |= (1ULL << 63); // set 63th bit to one
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 61);
-                        blackPieces |= (1ULL << 63);
-                        break;
-                    case 58: // black queen side
-                        blackRooks &= ~(1ULL << 59); // set 59th bit to zero
-                        blackRooks |= (1ULL << 56); // set 56th bit to one
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 59);
-                        blackPieces |= (1ULL << 56);
-                        break;
+            case MOVE_PROMOTION:
+                if (capturedPiece != 0){
+                    pieceBB[them][ALL] |= toMask;
+                    pieceBB[them][capturedPiece] |= toMask;
+                    mailbox[to] = capturedPiece;
                 }
+                // the promoted piece turns back into a pawn, no need to adjust the color bitboards
+                pieceBB[us][PAWN] |= fromMask;
+                pieceBB[us][movedPiece] &= ~fromMask;
+                mailbox[from] = PAWN;
+                break;
+            case MOVE_CASTLING: {
+                uint8_t rookFrom = to > from ? to + 1 : to - 2;
+                uint8_t rookTo = to > from ? to - 1 : to + 1;
+                uint64_t rookMask = (1ULL << rookFrom) | (1ULL << rookTo);
+                pieceBB[us][ROOK] ^= rookMask;
+                pieceBB[us][ALL] ^= rookMask;
+                mailbox[rookTo] = 0;
+                mailbox[rookFrom] = ROOK;
+                break;
             }
         }
 
         // Set all Pieces
-        allOccupied = whitePieces | blackPieces;
+        allOccupied = pieceBB[WHITE][ALL] | pieceBB[BLACK][ALL];
 
         // Update game state information //
-        whiteToMove = !whiteToMove;
-        capturedPieceHistory[plycount] = 0; // clear last captured Piece
-        castlingRightHistory[plycount] = 0; // clear last castling right
-        enPassantFileHistory[plycount] = 0; // clear last enPassant file
-        halfmoveClockHistory[plycount] = 0; // clear last halfmoveValue
-        zobristKeyHistory[plycount] = 0;    // clear last zobristKey
-        if (!whiteToMove) fullmoveNumber--;
-        zobristKey = getZobristKey();
+        whiteToMove = White;
+        attackInfoValid = 0;
+        if (!White) fullmoveNumber--;
         plycount--;
+#ifdef WOKFISCH_DEBUG
+        assert(zobristKey == getZobristKey() && "restored zobrist key diverged from full recomputation");
+#endif
+    };
+
+    inline void unmakeMove(){
+        if (history.size() <= 1) return;  // No moves to undo
+        // the side that made the last move is the one not to move now
+        whiteToMove ? undoMove<false>() : undoMove<true>();
     };
 
+    // Copy-make
+    // Everything a move changes apart from the history, saved before the move and copied back to take it back,
+    // instead of undoMove reversing it piece by piece. That is one fixed size copy per move and no branches,
+    // and the cached attack info of the position comes back with it instead of being recomputed.
+    // The game history is shared, restore pops the record the move pushed.
+    struct Snapshot {
+        Position position;
+        AttackInfo attackInfo;
+        uint8_t attackInfoValid;
+    };
+    inline void save(Snapshot& snapshot) const {
+        snapshot.position = *this;
+        snapshot.attackInfo = attackInfo;
+        snapshot.attackInfoValid = attackInfoValid;
+    }
+    // take back the one move made since save(snapshot)
+    inline void restore(const Snapshot& snapshot) {
+        static_cast<Position&>(*this) = snapshot.position;
+        attackInfo = snapshot.attackInfo;
+        attackInfoValid = snapshot.attackInfoValid;
+        history.pop();
+        plycount--;
+    }
+    // pass, for null move pruning. Like Stockfish the null move goes on the history, so the repetition scans
+    // stop at it, and it clears the en passant file, which belonged to the other side.
+    inline void makeNullMove() {
+        uint64_t key = zobristKey ^ ZOBRIST.whiteToMoveHash;
+        if (enPassantFile != 0xFF) key ^= ZOBRIST.enPassantHash[enPassantFile];
+        enPassantFile = 0xFF;
+        whiteToMove = !whiteToMove;
+        attackInfoValid = 0;
+        halfmoveClock++;
+        zobristKey = key;
+        history.push(0, 0, castlingRights, enPassantFile, halfmoveClock, zobristKey);
+    }
+    inline void unmakeNullMove() {
+        history.pop();
+        const UndoRecord& previous = history.back();
+        enPassantFile = previous.enPassantFile;
+        halfmoveClock = previous.halfmoveClock;
+        zobristKey = previous.zobristKey;
+        whiteToMove = !whiteToMove;
+        attackInfoValid = 0;
+    }
+
     // Game end functions
-    inline bool isCheck() {
-        uint8_t kingsquare = ctz64(whiteToMove ? whiteKing : blackKing);
+    // is the king of color White attacked
+    template<bool White>
+    inline bool kingAttacked() {
+        uint8_t kingsquare = ctz64(king<White>());
         
         // Pawn attacks
         // check left pawn attack
-        bool left_pawn_attack = whiteToMove ? 
+        bool left_pawn_attack = White ? 
             // only check by panws if kingsquare < 48
-            (kingsquare < 48 && kingsquare % 8 != 0 && (blackPawns & (1ULL << (kingsquare + 7)))) :
+            (kingsquare < 48 && kingsquare % 8 != 0 && (pieceBB[BLACK][PAWN] & (1ULL << (kingsquare + 7)))) :
             // no check by pawns if kingsquare > 15
-            (kingsquare > 15 && kingsquare % 8 != 0 && (whitePawns & (1ULL << (kingsquare - 9))));
+            (kingsquare > 15 && kingsquare % 8 != 0 && (pieceBB[WHITE][PAWN] & (1ULL << (kingsquare - 9))));
         // check right pawn attack
-        bool right_pawn_attack = whiteToMove ? 
-            (kingsquare < 48 && kingsquare % 8 != 7 && (blackPawns & (1ULL << (kingsquare + 9)))) :
-            (kingsquare > 15 && kingsquare % 8 != 7 && (whitePawns & (1ULL << (kingsquare - 7))));
+        bool right_pawn_attack = White ? 
+            (kingsquare < 48 && kingsquare % 8 != 7 && (pieceBB[BLACK][PAWN] & (1ULL << (kingsquare + 9)))) :
+            (kingsquare > 15 && kingsquare % 8 != 7 && (pieceBB[WHITE][PAWN] & (1ULL << (kingsquare - 7))));
 
         if (left_pawn_attack || right_pawn_attack) {
             return true;
         }
 
         // Knight attacks
-        uint64_t opponent_knights = whiteToMove ? blackKnights : whiteKnights;
+        uint64_t opponent_knights = pieceBB[White ? BLACK : WHITE][KNIGHT];
         if (knight_lookup[kingsquare] & opponent_knights) {
             return true;
         }
 
         // Slider attacks
-        uint64_t opponent_bishops = whiteToMove ? blackBishops : whiteBishops;
-        uint64_t opponent_queens = whiteToMove ? blackQueens : whiteQueens;
-        uint64_t opponent_rooks = whiteToMove ? blackRooks : whiteRooks;
-        uint64_t enemyPieces = whiteToMove ? blackPieces : whitePieces;
+        uint64_t opponent_bishops = pieceBB[White ? BLACK : WHITE][BISHOP];
+        uint64_t opponent_queens = pieceBB[White ? BLACK : WHITE][QUEEN];
+        uint64_t opponent_rooks = pieceBB[White ? BLACK : WHITE][ROOK];
+        uint64_t enemyPieces = pieceBB[White ? BLACK : WHITE][ALL];
 
         // Bishop & Queen attacks
-        const MagicEntry& bishop_entry = BISHOP_MAGICS[kingsquare];
-        uint64_t bishop_index = ((allOccupied & bishop_entry.mask) * bishop_entry.magic) >> (64 - bishop_entry.shift);
-        uint64_t bishop_attacks = bishop_entry.moves[bishop_index] & (enemyPieces | ~allOccupied);
+        uint64_t bishop_attacks = bishopAttacks(kingsquare, allOccupied) & (enemyPieces | ~allOccupied);
         if (bishop_attacks & (opponent_bishops | opponent_queens)) {
             return true;
         }
 
         // Rook & Queen attacks
-        const MagicEntry& rook_entry = ROOK_MAGICS[kingsquare];
-        uint64_t rook_index = ((allOccupied & rook_entry.mask) * rook_entry.magic) >> (64 - rook_entry.shift);
-        uint64_t rook_attacks = rook_entry.moves[rook_index] & (enemyPieces | ~allOccupied);
+        uint64_t rook_attacks = rookAttacks(kingsquare, allOccupied) & (enemyPieces | ~allOccupied);
         if (rook_attacks & (opponent_rooks | opponent_queens)) {
             return true;
         }
 
         // King attacks
-        uint64_t opponent_king = whiteToMove ? blackKing : whiteKing;
+        uint64_t opponent_king = pieceBB[White ? BLACK : WHITE][KING];
         if (king_lookup[kingsquare] & opponent_king) {
             return true;
         }
 
         return false;
     }
+    inline bool isCheck() {
+        return (whiteToMove ? getCheckInfo<true>() : getCheckInfo<false>()).checkers != 0;
+    }
+    // does a legal move of White (the side to move) give check, answered without making the move
+    template<bool White>
+    inline bool givesCheck(uint16_t move) {
+        const AttackInfo& info = getGivesCheckInfo<White>();
+        uint8_t from = move & 0x3F;
+        uint8_t to = (move >> 6) & 0x3F;
+        uint64_t fromMask = 1ULL << from;
+        uint64_t toMask = 1ULL << to;
+        uint8_t movedPiece = mailbox[from];
+
+        // castling, only the rook can give check
+        if ((move >> 12) & 0x1) {
+            uint8_t rookFrom = to > from ? from + 3 : from - 4;
+            uint8_t rookTo = to > from ? from + 1 : from - 1;
+            uint64_t occupied = allOccupied ^ fromMask ^ toMask ^ (1ULL << rookFrom) ^ (1ULL << rookTo);
+            return rookAttacks(rookTo, occupied) & king<!White>();
+        }
+
+        bool isPromotion = (move >> 15) & 0x1;
+        bool isEnPassant = movedPiece == PAWN && (from & 7) != (to & 7) && !mailbox[to];
+        if (!isPromotion && !isEnPassant) {
+            // direct check from the target square, or a discovered check if the piece blocked one of our sliders
+            // and leaves the line between that slider and the king
+            return (info.checkSquares[movedPiece] & toMask)
+                || ((info.discoverers & fromMask) && !(LINE[from][to] & king<!White>()));
+        }
+
+        // promotions and en passant change more than the cached masks cover, look at the occupancy after the move
+        uint64_t occupied = (allOccupied ^ fromMask) | toMask;
+        if (isEnPassant) occupied ^= White ? toMask >> 8 : toMask << 8; // the captured pawn
+        uint8_t kingSquare = ctz64(king<!White>());
+        uint64_t direct;
+        switch (isPromotion ? ((move >> 13) & 0x3) + 2 : PAWN) {
+            case KNIGHT: direct = knight_lookup[to]; break;
+            case BISHOP: direct = bishopAttacks(to, occupied); break;
+            case ROOK: direct = rookAttacks(to, occupied); break;
+            case QUEEN: direct = bishopAttacks(to, occupied) | rookAttacks(to, occupied); break;
+            default: direct = pawnAttacks<White>(toMask); break;
+        }
+        return (direct & (1ULL << kingSquare)) || discoveredCheck<White>(occupied, fromMask);
+    }
+    inline bool givesCheck(uint16_t move) {
+        return whiteToMove ? givesCheck<true>(move) : givesCheck<false>(move);
+    }
+    // is the enemy king attacked by a slider of White with the given occupancy, the piece that left vacated doesn't count
+    template<bool White>
+    inline bool discoveredCheck(uint64_t occupied, uint64_t vacated) {
+        uint8_t kingSquare = ctz64(king<!White>());
+        return ((bishopAttacks(kingSquare, occupied) & (bishops<White>() | queens<White>()))
+              | (rookAttacks(kingSquare, occupied) & (rooks<White>() | queens<White>()))) & ~vacated;
+    }
+
+    // Static exchange evaluation
+    // pieces of both colors that attack square with the given occupancy, removed pieces have to be cleared from occupied
+    inline uint64_t attackersTo(uint8_t square, uint64_t occupied) {
+        uint64_t squareMask = 1ULL << square;
+        return ((pawnAttacks<false>(squareMask) & pieceBB[WHITE][PAWN])
+              | (pawnAttacks<true>(squareMask) & pieceBB[BLACK][PAWN])
+              | (knight_lookup[square] & (pieceBB[WHITE][KNIGHT] | pieceBB[BLACK][KNIGHT]))
+              | (king_lookup[square] & (pieceBB[WHITE][KING] | pieceBB[BLACK][KING]))
+              | (bishopAttacks(square, occupied) & diagonalSliders())
+              | (rookAttacks(square, occupied) & orthogonalSliders())) & occupied;
+    }
+    inline uint64_t diagonalSliders() const {
+        return pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    }
+    inline uint64_t orthogonalSliders() const {
+        return pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK] | pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN];
+    }
+    // least valuable piece of color among attackers, 0 if there is none
+    inline uint8_t leastValuableAttacker(uint64_t attackers, int color, uint64_t& attacker) {
+        for (uint8_t piece = PAWN; piece <= KING; ++piece) {
+            uint64_t candidates = attackers & pieceBB[color][piece];
+            if (candidates) {
+                attacker = candidates & -candidates;
+                return piece;
+            }
+        }
+        return 0;
+    }
+    // material the side to move wins with move if both sides keep recapturing on the target square with their
+    // least valuable piece and may stop whenever that is better for them, sliders behind a capturer join in (x-rays).
+    // Pins are ignored. Swap list algorithm, https://www.chessprogramming.org/SEE_-_The_Swap_Algorithm
+    int see(uint16_t move) {
+        uint8_t from = move & 0x3F;
+        uint8_t to = (move >> 6) & 0x3F;
+        if ((move >> 12) & 0x1) return 0; // castling
+        uint8_t piece = mailbox[from];
+        uint64_t occupied = allOccupied ^ (1ULL << from);
+
+        int gain[32];
+        int d = 0;
+        gain[0] = SEE_VALUE[mailbox[to]];
+        if (piece == PAWN && (from & 7) != (to & 7) && !mailbox[to]) { // en passant
+            gain[0] = SEE_VALUE[PAWN];
+            occupied ^= whiteToMove ? (1ULL << to) >> 8 : (1ULL << to) << 8;
+        }
+        if ((move >> 15) & 0x1) {
+            piece = ((move >> 13) & 0x3) + 2;
+            gain[0] += SEE_VALUE[piece] - SEE_VALUE[PAWN];
+        }
+
+        uint64_t attackers = attackersTo(to, occupied);
+        int side = whiteToMove ? BLACK : WHITE; // side to recapture
+        while (true) {
+            d++;
+            gain[d] = SEE_VALUE[piece] - gain[d-1]; // what side gets by capturing piece, if it isn't recaptured
+            uint64_t attacker;
+            uint8_t next = leastValuableAttacker(attackers, side, attacker);
+            if (!next) break;
+            if (next == KING && (attackers & pieceBB[side ^ 1][ALL])) break; // the king can't take a defended piece
+            occupied ^= attacker;
+            attackers = (attackers | (bishopAttacks(to, occupied) & diagonalSliders()) | (rookAttacks(to, occupied) & orthogonalSliders())) & occupied;
+            piece = next;
+            side ^= 1;
+        }
+        while (--d) gain[d-1] = -std::max(-gain[d-1], gain[d]);
+        return gain[0];
+    }
+    // see(move) >= threshold, stops as soon as the outcome is known
+    bool seeGE(uint16_t move, int threshold) {
+        uint8_t from = move & 0x3F;
+        uint8_t to = (move >> 6) & 0x3F;
+        uint8_t piece = mailbox[from];
+        // castling, promotions and en passant are rare enough for the full swap list
+        if (((move >> 12) & 0x1) || ((move >> 15) & 0x1) || (piece == PAWN && (from & 7) != (to & 7) && !mailbox[to])) {
+            return see(move) >= threshold;
+        }
+
+        int swap = SEE_VALUE[mailbox[to]] - threshold;
+        if (swap < 0) return false; // even an unanswered capture isn't enough
+        swap = SEE_VALUE[piece] - swap;
+        if (swap <= 0) return true; // even losing the moved piece is still enough
+
+        uint64_t occupied = allOccupied ^ (1ULL << from);
+        uint64_t attackers = attackersTo(to, occupied);
+        int side = whiteToMove ? WHITE : BLACK;
+        bool result = true;
+        while (true) {
+            side ^= 1;
+            attackers &= occupied;
+            uint64_t attacker;
+            uint8_t next = leastValuableAttacker(attackers, side, attacker);
+            if (!next) break;
+            result = !result;
+            // a king capture is only possible if the other side has nothing left to recapture with
+            if (next == KING) return (attackers & pieceBB[side ^ 1][ALL]) ? !result : result;
+            swap = SEE_VALUE[next] - swap;
+            if (swap < result) break;
+            occupied ^= attacker;
+            attackers |= (bishopAttacks(to, occupied) & diagonalSliders()) | (rookAttacks(to, occupied) & orthogonalSliders());
+        }
+        return result;
+    }
     inline bool isCheckmate(){
         // First, check if the current player is in check
         if (!isCheck()) {
             return false;
         }
-        // If in check, generate all legal moves
-        std::vector<uint16_t> legalMoves = generateAllLegalMoves();
         // If there are no legal moves, it's checkmate
-        return legalMoves.empty();
+        return countAllLegalMoves() == 0;
     };
     inline bool isDraw() {
         // 1. Insufficient material
@@ -1450,17 +1612,17 @@ public:
     }
     bool isInsufficientMaterial() {
         // King vs. King
-        if (whitePieces == whiteKing && blackPieces == blackKing) {
+        if (pieceBB[WHITE][ALL] == pieceBB[WHITE][KING] && pieceBB[BLACK][ALL] == pieceBB[BLACK][KING]) {
             return true;
         }
         // King and Bishop vs. King
-        if ((whitePieces == (whiteKing | whiteBishops) && popcount64(whiteBishops) == 1 && blackPieces == blackKing) ||
-            (blackPieces == (blackKing | blackBishops) && popcount64(blackBishops) == 1 && whitePieces == whiteKing)) {
+        if ((pieceBB[WHITE][ALL] == (pieceBB[WHITE][KING] | pieceBB[WHITE][BISHOP]) && popcount64(pieceBB[WHITE][BISHOP]) == 1 && pieceBB[BLACK][ALL] == pieceBB[BLACK][KING]) ||
+            (pieceBB[BLACK][ALL] == (pieceBB[BLACK][KING] | pieceBB[BLACK][BISHOP]) && popcount64(pieceBB[BLACK][BISHOP]) == 1 && pieceBB[WHITE][ALL] == pieceBB[WHITE][KING])) {
             return true;
         }
         // King and Knight vs. King
-        if ((whitePieces == (whiteKing | whiteKnights) && popcount64(whiteKnights) == 1 && blackPieces == blackKing) ||
-            (blackPieces == (blackKing | blackKnights) && popcount64(blackKnights) == 1 && whitePieces == whiteKing)) {
+        if ((pieceBB[WHITE][ALL] == (pieceBB[WHITE][KING] | pieceBB[WHITE][KNIGHT]) && popcount64(pieceBB[WHITE][KNIGHT]) == 1 && pieceBB[BLACK][ALL] == pieceBB[BLACK][KING]) ||
+            (pieceBB[BLACK][ALL] == (pieceBB[BLACK][KING] | pieceBB[BLACK][KNIGHT]) && popcount64(pieceBB[BLACK][KNIGHT]) == 1 && pieceBB[WHITE][ALL] == pieceBB[WHITE][KING])) {
             return true;
         }
         return false;
@@ -1469,56 +1631,81 @@ public:
         if (isCheck()) {
             return false;
         }
-        return generateAllLegalMoves().empty();
+        return countAllLegalMoves() == 0;
     }
+    // the current position occurred twice before, only positions since the last irreversible move can repeat.
+    // Scans never look past a null move, the positions before it were reached with the other side to move.
     bool isThreefoldRepetition() {
-        int startind = plycount - halfmoveClockHistory[plycount];
-        int endind = plycount;
-        std::unordered_map<uint64_t, int> keyCount;
-
-        //  Loop through the Zobrist key history
-        for (int i = startind; i <= endind; ++i) {
-            uint64_t key = zobristKeyHistory[i];
-            // Increment the count for this key
-            keyCount[key]++;
-            // If any key appears 3 times, we have a threefold repetition
-            if (keyCount[key] >= 3) {
+        int current = (int)history.size() - 1;
+        int end = current - std::min((int)halfmoveClock, (int)history.back().pliesFromNull);
+        int count = 0;
+        for (int i = current - 4; i >= end; i -= 2) {
+            if (history[i].zobristKey == zobristKey && ++count == 2) {
                 return true;
             }
         }
         return false;
     }
     bool isFiftyMoveRule() {
-        return halfmoveClockHistory[plycount] >= 100;  // 50 moves by each player
+        return halfmoveClock >= 100;  // 50 moves by each player
     }
     bool isRepeatedPosition(uint64_t key) {
-        int currentHalfmove = halfmoveClockHistory[plycount];
+        int currentHalfmove = std::min((int)halfmoveClock, (int)history.back().pliesFromNull);
         
         // Start from the current position and go back
-        // We only need to check as far back as the current halfmove clock value
-        for (int i = plycount - 2; i >= 0 && i >= plycount - currentHalfmove; i -= 2) {
-            if (zobristKeyHistory[i] == key) {
+        // We only need to check as far back as the current halfmove clock value, or the last null move
+        int current = (int)history.size() - 1;
+        for (int i = current - 2; i >= 0 && i >= current - currentHalfmove; i -= 2) {
+            if (history[i].zobristKey == key) {
                 return true;
             }
         }
-        
+
         return false;
     }
-    
+    // The side to move has a reversible move back into a position played since the last irreversible move,
+    // so it can force at least a draw by repetition (https://www.chessprogramming.org/Repetitions, cuckoo tables).
+    // ply is the distance to the search root, positions from before the root have to be repeated once already.
+    bool hasUpcomingRepetition(int ply) {
+        int current = (int)history.size() - 1;
+        int end = std::min((int)halfmoveClock, (int)history.back().pliesFromNull);
+        if (end < 3) return false;
+
+        // other is 0 whenever the opponent's pieces stand as i plies ago
+        uint64_t other = zobristKey ^ history[current - 1].zobristKey ^ ZOBRIST.whiteToMoveHash;
+        for (int i = 3; i <= end; i += 2) {
+            other ^= history[current - i + 1].zobristKey ^ history[current - i].zobristKey ^ ZOBRIST.whiteToMoveHash;
+            if (other != 0) continue;
+
+            uint64_t moveKey = zobristKey ^ history[current - i].zobristKey;
+            int slot = cuckooH1(moveKey);
+            if (CUCKOO.keys[slot] != moveKey) {
+                slot = cuckooH2(moveKey);
+                if (CUCKOO.keys[slot] != moveKey) continue;
+            }
+            uint8_t s1 = CUCKOO.moves[slot] & 0x3F;
+            uint8_t s2 = (CUCKOO.moves[slot] >> 6) & 0x3F;
+            if ((BETWEEN[s1][s2] ^ (1ULL << s2)) & allOccupied) continue; // something stands in the way
+
+            if (ply > i) return true;
+            // both directions share the entry, the piece has to be ours to move back
+            uint64_t own = pieceBB[whiteToMove ? WHITE : BLACK][ALL];
+            if (!(((own >> s1) | (own >> s2)) & 1)) continue;
+            // at or before the root the earlier position has to have occurred twice already
+            for (int j = i + 4; j <= end; j += 2) {
+                if (history[current - j].zobristKey == history[current - i].zobristKey) return true;
+            }
+        }
+        return false;
+    }
+
     // Utility functions
     inline uint8_t getPieceOfSquare(uint8_t square) {
-        uint64_t squareBB = 1ULL << square; 
-        if (squareBB & (whitePawns | blackPawns)) return 1;
-        if (squareBB & (whiteKnights | blackKnights)) return 2;
-        if (squareBB & (whiteBishops | blackBishops)) return 3;
-        if (squareBB & (whiteRooks | blackRooks)) return 4;
-        if (squareBB & (whiteQueens | blackQueens)) return 5;
-        if (squareBB & (whiteKing | blackKing)) return 6;
-        return 0;
+        return mailbox[square];
     }
     bool rightColor(uint8_t square){
         uint64_t squareBB = 1ULL << square;
-        return (whiteToMove && (whitePieces & squareBB)) || (!whiteToMove && (blackPieces & squareBB));
+        return (whiteToMove && (pieceBB[WHITE][ALL] & squareBB)) || (!whiteToMove && (pieceBB[BLACK][ALL] & squareBB));
     }
     uint16_t inputMove(uint8_t from, uint8_t to, uint8_t promotionPiece = 0){
         uint16_t data = (from & 0x3F) | ((to & 0x3F) << 6);
@@ -1563,7 +1750,7 @@ public:
         return data;
     }
     uint16_t generateMove(int from, int to){
-        std::vector<uint16_t> allMoves = generateAllLegalMoves();
+        MoveList allMoves = generateAllLegalMoves();
         for (uint16_t move : allMoves) {
             if ((from == (move & 0x3F)) && (to == ((move >> 6) & 0x3F))) {
                 return move;
@@ -1572,7 +1759,7 @@ public:
         return 0; // Return 0 if no matching move is found
     }
     std::vector<uint16_t> generateLegalMovesOfSquare(int from) {
-        std::vector<uint16_t> allMoves = generateAllLegalMoves();
+        MoveList allMoves = generateAllLegalMoves();
         std::vector<uint16_t> movesOfSquares;
 
         for (uint16_t move : allMoves) {
@@ -1585,31 +1772,26 @@ public:
     }
     std::vector<uint64_t> reportBitboards(){
         std::vector<uint64_t> bitboards;
-        bitboards.push_back(whitePawns);
-        bitboards.push_back(blackPawns);
-        bitboards.push_back(whiteKnights);
-        bitboards.push_back(blackKnights);
-        bitboards.push_back(whiteBishops);
-        bitboards.push_back(blackBishops);
-        bitboards.push_back(whiteRooks);
-        bitboards.push_back(blackRooks);
-        bitboards.push_back(whiteQueens);
-        bitboards.push_back(blackQueens);
-        bitboards.push_back(whiteKing);
-        bitboards.push_back(blackKing);
+        for (int piece = PAWN; piece <= KING; ++piece) {
+            bitboards.push_back(pieceBB[WHITE][piece]);
+            bitboards.push_back(pieceBB[BLACK][piece]);
+        }
         return bitboards;
     }
     std::vector<uint16_t> returnMoveHistory(){
-        return std::vector<uint16_t>(moveHistory, moveHistory + plycount);
+        std::vector<uint16_t> moves;
+        moves.reserve(history.size());
+        for (size_t i = 0; i + 1 < history.size(); ++i) moves.push_back(history[i].move);
+        return moves;
     }
     uint16_t getLastMove(){
-        if (plycount == 0 || plycount == 1){
+        if (history.size() < 3){
             return 0;
         }
-        return moveHistory[plycount-2];
+        return history[history.size()-3].move;
     }
     bool isCapture(uint16_t move){
-        return (whiteToMove ? blackPieces : whitePieces) & (1Ull << (move >> 6) & 0x3F);
+        return (whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL]) & (1Ull << (move >> 6) & 0x3F);
     }
     std::vector<float> generateSparseVector(){
         std::vector<float> sparseVector;
@@ -1639,21 +1821,7 @@ public:
                 int square = rank * 8 + file;
                 char piece = '.';
                 for (int i = 0; i < 12; ++i) {
-                    uint64_t bb = 0ULL;
-                    switch (i) {
-                        case 0: bb = whitePawns; break;
-                        case 1: bb = whiteKnights; break;
-                        case 2: bb = whiteBishops; break;
-                        case 3: bb = whiteRooks; break;
-                        case 4: bb = whiteQueens; break;
-                        case 5: bb = whiteKing; break;
-                        case 6: bb = blackPawns; break;
-                        case 7: bb = blackKnights; break;
-                        case 8: bb = blackBishops; break;
-                        case 9: bb = blackRooks; break;
-                        case 10: bb = blackQueens; break;
-                        case 11: bb = blackKing; break;
-                    }
+                    uint64_t bb = pieceBB[i / 6][i % 6 + 1];
                     if (bb & (1ULL << square)) {
                         piece = pieces[i];
                         break;
@@ -1668,17 +1836,15 @@ public:
 
         // out << "Turn: " << (whiteToMove ? "White" : "Black") << "\n";
         // out << "Castling rights: ";
-        // uint8_t castlingRights = castlingRightHistory[plycount];
-        // if (castlingRights & 8) out << "K";
+                // if (castlingRights & 8) out << "K";
         // if (castlingRights & 4) out << "Q";
         // if (castlingRights & 2) out << "k";
         // if (castlingRights & 1) out << "q";
         // if (castlingRights == 0) out << "-";
         // out << "\n";
 
-        // uint8_t enPassantFile = enPassantFileHistory[plycount];
-        // out << "enPassantFile: " << std::to_string(enPassantFile) << "\n";         
-        // out << "Halfmove clock: " << halfmoveClockHistory[plycount] << "\n";
+                // out << "enPassantFile: " << std::to_string(enPassantFile) << "\n";         
+        // out << "Halfmove clock: " << halfmoveClock << "\n";
         // out << "Fullmove number: " << fullmoveNumber << "\n";
     }
     void printBitboard(uint64_t bitboard) {
@@ -1698,40 +1864,40 @@ public:
     }
     void printAll(){
         std::cout << "whitePawns: " << std::endl;
-        printBitboard(whitePawns);
+        printBitboard(pieceBB[WHITE][PAWN]);
         std::cout << "blackPawns: " << std::endl;
-        printBitboard(blackPawns);
+        printBitboard(pieceBB[BLACK][PAWN]);
         std::cout << "whiteKnights: " << std::endl;
-        printBitboard(whiteKnights);
+        printBitboard(pieceBB[WHITE][KNIGHT]);
         std::cout << "blackKnights: " << std::endl;
-        printBitboard(blackKnights);
+        printBitboard(pieceBB[BLACK][KNIGHT]);
         std::cout << "whiteBishops: " << std::endl;
-        printBitboard(whiteBishops);
+        printBitboard(pieceBB[WHITE][BISHOP]);
         std::cout << "blackBishops: " << std::endl;
-        printBitboard(blackBishops);
+        printBitboard(pieceBB[BLACK][BISHOP]);
         std::cout << "whiteRooks: " << std::endl;
-        printBitboard(whiteRooks);
+        printBitboard(pieceBB[WHITE][ROOK]);
         std::cout << "blackRooks: " << std::endl;
-        printBitboard(blackRooks);
+        printBitboard(pieceBB[BLACK][ROOK]);
         std::cout << "whiteQueens: " << std::endl;
-        printBitboard(whiteQueens);
+        printBitboard(pieceBB[WHITE][QUEEN]);
         std::cout << "blackQueens: " << std::endl;
-        printBitboard(blackQueens);
+        printBitboard(pieceBB[BLACK][QUEEN]);
         std::cout << "whiteKing: " << std::endl;
-        printBitboard(whiteKing);
+        printBitboard(pieceBB[WHITE][KING]);
         std::cout << "blackKing: " << std::endl;
-        printBitboard(blackKing);
+        printBitboard(pieceBB[BLACK][KING]);
         std::cout << "whitePieces: " << std::endl;
-        printBitboard(whitePieces);
+        printBitboard(pieceBB[WHITE][ALL]);
         std::cout << "blackPieces: " << std::endl;
-        printBitboard(blackPieces);
+        printBitboard(pieceBB[BLACK][ALL]);
         std::cout << "allOccupied: " << std::endl;
         printBitboard(allOccupied);
 
         std::cout << "whiteToMove: " << whiteToMove << std::endl;
-        std::cout << "castlingRights: " << std::bitset<4>(castlingRightHistory[plycount]) << std::endl;
-        std::cout << "enPassantFile: " << std::to_string(enPassantFileHistory[plycount]) << std::endl;
-        std::cout << "halfmoveClock: " << halfmoveClockHistory[plycount] << std::endl;
+        std::cout << "castlingRights: " << std::bitset<4>(castlingRights) << std::endl;
+        std::cout << "enPassantFile: " << std::to_string(enPassantFile) << std::endl;
+        std::cout << "halfmoveClock: " << halfmoveClock << std::endl;
         std::cout << "fullmoveNumber: " << fullmoveNumber << std::endl;
     }
     std::string moveToString(uint16_t move) {
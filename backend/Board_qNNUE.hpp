@@ -1,12 +1,18 @@
 #pragma once
 #include <vector>
 #include <string>
+#include <string_view>
 #include <cstdint>
 #include <iostream>
 #include <sstream>
-#include <random>
 #include <fstream>
+#include <cstring>
+#include <algorithm>
+#include <cmath>
+#include <bitset>
 #include "MoveMap.hpp"
+#include "Zobrist.hpp"
+#include "Fen.hpp"
 #include "constants.hpp"
 #include <arm_neon.h>
 
@@ -46,14 +52,8 @@ struct Indices {
 class Board_qNNUE{
 public:
     // Bitboards
-    uint64_t whitePawns, blackPawns;
-    uint64_t whiteKnights, blackKnights;
-    uint64_t whiteBishops, blackBishops;
-    uint64_t whiteRooks, blackRooks;
-    uint64_t whiteQueens, blackQueens;
-    uint64_t whiteKing, blackKing;
-    uint64_t whitePieces;
-    uint64_t blackPieces;
+    // indexed [color][piece] with WHITE/BLACK and PAWN ... KING, [color][ALL] holds every piece of a color
+    uint64_t pieceBB[2][7];
     uint64_t allOccupied;
 
     // Game State Information
@@ -69,13 +69,6 @@ public:
     uint8_t castlingRightHistory[1000] = {0}; // Stores the castling rights in an arr
     uint16_t halfmoveClockHistory[1000] = {0}; // Stores the halfMoveValues in an arr
     uint64_t zobristKeyHistory[1000] = {0}; // Stores the zobristKey in an arr, for threefold repetition
-    std::unordered_map<uint64_t, int> positionHashHistory; // Stores the hashes with the # of times it occured
-    
-    // Zobrist hash values
-    uint64_t pieceHash[12][64]; // 12 types of pieces (6 white + 6 black) and 64 squares
-    uint64_t whiteToMoveHash;   // 1 element for current side
-    uint64_t castlingHash[16];  // 16 possible castling rights (4 bits)
-    uint64_t enPassantHash[8];  // 8 possible en passant files
 
     // NNUE
     alignas(32) int16_t aggregator[2 * 3072]; // One aggregator for white and one for black
@@ -96,7 +89,6 @@ public:
     
     // Constructors and Initialization 
     Board_qNNUE(std::string fen = "") {
-        initializeZobristHashes(); // Initialize Zobrist hashe values when the board is created
         initializePrecomputedIndices(); // Initialize precomputed indices
         if (fen.empty()) {
             reset();
@@ -144,39 +136,29 @@ public:
         fc1_path1_bias.clear();
         fc1_path2_bias.clear();
         fc2_weights.clear();
-        
-        // Clear hash map
-        positionHashHistory.clear();
     }
     void reset(){
         // Reset all bitboards to 0
-        whitePawns = blackPawns = 0ULL;
-        whiteKnights = blackKnights = 0ULL;
-        whiteBishops = blackBishops = 0ULL;
-        whiteRooks = blackRooks = 0ULL;
-        whiteQueens = blackQueens = 0ULL;
-        whiteKing = blackKing = 0ULL;
+        std::memset(pieceBB, 0, sizeof(pieceBB));
 
         // Set up white pieces
-        whitePawns = 0x000000000000FF00ULL;
-        whiteKnights = 0x0000000000000042ULL;
-        whiteBishops = 0x0000000000000024ULL;
-        whiteRooks = 0x0000000000000081ULL;
-        whiteQueens = 0x0000000000000008ULL;
-        whiteKing = 0x0000000000000010ULL;
+        pieceBB[WHITE][PAWN] = 0x000000000000FF00ULL;
+        pieceBB[WHITE][KNIGHT] = 0x0000000000000042ULL;
+        pieceBB[WHITE][BISHOP] = 0x0000000000000024ULL;
+        pieceBB[WHITE][ROOK] = 0x0000000000000081ULL;
+        pieceBB[WHITE][QUEEN] = 0x0000000000000008ULL;
+        pieceBB[WHITE][KING] = 0x0000000000000010ULL;
 
         // Set up black pieces
-        blackPawns = 0x00FF000000000000ULL;
-        blackKnights = 0x4200000000000000ULL;
-        blackBishops = 0x2400000000000000ULL;
-        blackRooks = 0x8100000000000000ULL;
-        blackQueens = 0x0800000000000000ULL;
-        blackKing = 0x1000000000000000ULL;
+        pieceBB[BLACK][PAWN] = 0x00FF000000000000ULL;
+        pieceBB[BLACK][KNIGHT] = 0x4200000000000000ULL;
+        pieceBB[BLACK][BISHOP] = 0x2400000000000000ULL;
+        pieceBB[BLACK][ROOK] = 0x8100000000000000ULL;
+        pieceBB[BLACK][QUEEN] = 0x0800000000000000ULL;
+        pieceBB[BLACK][KING] = 0x1000000000000000ULL;
 
         // Set up color bitboards and all occupied squares
-        whitePieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        blackPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        allOccupied = whitePieces | blackPieces;
+        setOccupancy();
 
         // reset game state information
         whiteToMove = true;
@@ -194,83 +176,70 @@ public:
         zobristKeyHistory[plycount] = zobristKey;
         enPassantFileHistory[0] = 0xFF; // set all bits -> mean no en passant file
         castlingRightHistory[0] = 0xF; // set all castling rights true
-        // positionHashHistory.clear();
     }
-    void FENtoBoard(std::string fen) {
+    // accepts a full FEN or the first four fields of an EPD line, the move counters default to 0 and 1
+    void FENtoBoard(std::string_view fen) {
+        FenFields fields;
+        splitFEN(fen, fields);
+        setFEN(fields);
+    }
+    void setFEN(const FenFields& fields) {
         // reset Board
         emptyBoard();
-        // reset game history information
-        std::memset(moveHistory, 0, sizeof(moveHistory));
-        std::memset(capturedPieceHistory, 0, sizeof(capturedPieceHistory));
-        std::memset(enPassantFileHistory, 0xFF, sizeof(enPassantFileHistory));
-        std::memset(castlingRightHistory, 0, sizeof(castlingRightHistory));
-        std::memset(halfmoveClockHistory, 0, sizeof(halfmoveClockHistory));
-        std::memset(zobristKeyHistory, 0, sizeof(zobristKeyHistory));
-        
-        std::istringstream ss(fen);
-        std::string boardPos, activeColor, castling, enPassant, halfmoveClock, fullmoveN;
-        ss >> boardPos >> activeColor >> castling >> enPassant >> halfmoveClock >> fullmoveN;
 
         // Parse board position
         int rank = 7, file = 0;
-        for (char c : boardPos) {
+        for (char c : fields.placement) {
             if (c == '/') {
                 rank--;
                 file = 0;
-            } else if (std::isdigit(c)) {
+            } else if (c >= '1' && c <= '8') {
                 file += c - '0';
             } else {
-                uint64_t square = 1ULL << (rank * 8 + file);
-                switch (c) {
-                    case 'P': whitePawns |= square; break;
-                    case 'p': blackPawns |= square; break;
-                    case 'N': whiteKnights |= square; break;
-                    case 'n': blackKnights |= square; break;
-                    case 'B': whiteBishops |= square; break;
-                    case 'b': blackBishops |= square; break;
-                    case 'R': whiteRooks |= square; break;
-                    case 'r': blackRooks |= square; break;
-                    case 'Q': whiteQueens |= square; break;
-                    case 'q': blackQueens |= square; break;
-                    case 'K': whiteKing |= square; break;
-                    case 'k': blackKing |= square; break;
-                }
+                bool white;
+                uint8_t piece = fenPiece(c, white);
+                int square = rank * 8 + file;
+                if (piece && square >= 0 && square < 64) pieceBB[white ? WHITE : BLACK][piece] |= 1ULL << square;
                 file++;
             }
         }
 
         // Set color bitboards
-        whitePieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        blackPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        allOccupied = whitePieces | blackPieces;
+        setOccupancy();
 
         // Set game state information
-        whiteToMove = (activeColor == "w");
+        whiteToMove = fields.activeColor == "w";
         plycount = (whiteToMove) ? 0 : 1;
-        plycount += (std::stoi(fullmoveN)-1) * 2;
+        plycount += (std::max(fields.fullmoveNumber, 1) - 1) * 2;
+        if (plycount >= 999) plycount = whiteToMove ? 0 : 1; // the history arrays end at 1000 plies
+
+        // reset game history information, only the plies up to the current one can be read before they are written
+        std::memset(moveHistory, 0, (plycount + 1) * sizeof(moveHistory[0]));
+        std::memset(capturedPieceHistory, 0, (plycount + 1) * sizeof(capturedPieceHistory[0]));
+        std::memset(enPassantFileHistory, 0xFF, (plycount + 1) * sizeof(enPassantFileHistory[0]));
+        std::memset(castlingRightHistory, 0, (plycount + 1) * sizeof(castlingRightHistory[0]));
+        std::memset(halfmoveClockHistory, 0, (plycount + 1) * sizeof(halfmoveClockHistory[0]));
+        std::memset(zobristKeyHistory, 0, (plycount + 1) * sizeof(zobristKeyHistory[0]));
 
         uint8_t castlingRights = 0;
-        if (castling.find('K') != std::string::npos) castlingRights |= 8;
-        if (castling.find('Q') != std::string::npos) castlingRights |= 4;
-        if (castling.find('k') != std::string::npos) castlingRights |= 2;
-        if (castling.find('q') != std::string::npos) castlingRights |= 1;
+        for (char c : fields.castling) {
+            switch (c) {
+                case 'K': castlingRights |= 8; break;
+                case 'Q': castlingRights |= 4; break;
+                case 'k': castlingRights |= 2; break;
+                case 'q': castlingRights |= 1; break;
+            }
+        }
         castlingRightHistory[plycount] = castlingRights;
 
         uint8_t enPassantFile = 0xFF; // 255 is default
-        switch (enPassant[0]){
-            case 'a': enPassantFile = 0x0; break;
-            case 'b': enPassantFile = 0x1; break;
-            case 'c': enPassantFile = 0x2; break;
-            case 'd': enPassantFile = 0x3; break;
-            case 'e': enPassantFile = 0x4; break;
-            case 'f': enPassantFile = 0x5; break;
-            case 'g': enPassantFile = 0x6; break;
-            case 'h': enPassantFile = 0x7; break;
+        if (!fields.enPassant.empty() && fields.enPassant[0] >= 'a' && fields.enPassant[0] <= 'h') {
+            enPassantFile = fields.enPassant[0] - 'a';
         }
         enPassantFileHistory[plycount] = enPassantFile;
 
-        halfmoveClockHistory[plycount] = std::stoi(halfmoveClock);
-        fullmoveNumber = std::stoi(fullmoveN);
+        halfmoveClockHistory[plycount] = fields.halfmoveClock;
+        fullmoveNumber = fields.fullmoveNumber;
         zobristKey = getZobristKey();
         zobristKeyHistory[plycount] = zobristKey;
     }
@@ -283,18 +252,18 @@ public:
             for (int file = 0; file < 8; file++) {
                 uint64_t square = 1ULL << (rank * 8 + file);
                 char piece = ' ';
-                if (whitePawns & square) piece = 'P';
-                else if (blackPawns & square) piece = 'p';
-                else if (whiteKnights & square) piece = 'N';
-                else if (blackKnights & square) piece = 'n';
-                else if (whiteBishops & square) piece = 'B';
-                else if (blackBishops & square) piece = 'b';
-                else if (whiteRooks & square) piece = 'R';
-                else if (blackRooks & square) piece = 'r';
-                else if (whiteQueens & square) piece = 'Q';
-                else if (blackQueens & square) piece = 'q';
-                else if (whiteKing & square) piece = 'K';
-                else if (blackKing & square) piece = 'k';
+                if (pieceBB[WHITE][PAWN] & square) piece = 'P';
+                else if (pieceBB[BLACK][PAWN] & square) piece = 'p';
+                else if (pieceBB[WHITE][KNIGHT] & square) piece = 'N';
+                else if (pieceBB[BLACK][KNIGHT] & square) piece = 'n';
+                else if (pieceBB[WHITE][BISHOP] & square) piece = 'B';
+                else if (pieceBB[BLACK][BISHOP] & square) piece = 'b';
+                else if (pieceBB[WHITE][ROOK] & square) piece = 'R';
+                else if (pieceBB[BLACK][ROOK] & square) piece = 'r';
+                else if (pieceBB[WHITE][QUEEN] & square) piece = 'Q';
+                else if (pieceBB[BLACK][QUEEN] & square) piece = 'q';
+                else if (pieceBB[WHITE][KING] & square) piece = 'K';
+                else if (pieceBB[BLACK][KING] & square) piece = 'k';
 
                 if (piece != ' ') {
                     if (emptySquares > 0) {
@@ -348,131 +317,47 @@ public:
     }
     void emptyBoard(){
         // Reset all bitboards to 0, keep game state and game history information
-        whitePawns = blackPawns = 0ULL;
-        whiteKnights = blackKnights = 0ULL;
-        whiteBishops = blackBishops = 0ULL;
-        whiteRooks = blackRooks = 0ULL;
-        whiteQueens = blackQueens = 0ULL;
-        whiteKing = blackKing = 0ULL;
-        whitePieces = whitePawns | whiteKnights | whiteBishops | whiteRooks | whiteQueens | whiteKing;
-        blackPieces = blackPawns | blackKnights | blackBishops | blackRooks | blackQueens | blackKing;
-        allOccupied = whitePieces | blackPieces;
+        std::memset(pieceBB, 0, sizeof(pieceBB));
+        setOccupancy();
     }
-    
-    // Zobrist Hashing functions
-    void initializeZobristHashes() {
-        std::random_device rd; // Obtain a random number from hardware
-        std::mt19937 generator(rd()); // Seed the generator
-        std::uniform_int_distribution<uint64_t> distribution(0, UINT64_MAX); // Uniform distribution for 64-bit integers
-
-        // Initialize piece hashes
-        for (int pieceType = 0; pieceType < 12; ++pieceType) {
-            for (int square = 0; square < 64; ++square) {
-                pieceHash[pieceType][square] = distribution(generator);
-            }
-        }
 
-        whiteToMoveHash = distribution(generator);
-
-        // Initialize castling rights
-        for (int i = 0; i < 16; ++i) {
-            castlingHash[i] = distribution(generator);
-        }
-
-        // Initialize en passant hashes
-        for (int i = 0; i < 8; ++i) {
-            enPassantHash[i] = distribution(generator);
+    // rebuild the color bitboards and all occupied squares from the piece bitboards
+    void setOccupancy(){
+        for (int color = WHITE; color <= BLACK; ++color) {
+            pieceBB[color][ALL] = 0ULL;
+            for (int piece = PAWN; piece <= KING; ++piece) pieceBB[color][ALL] |= pieceBB[color][piece];
         }
+        allOccupied = pieceBB[WHITE][ALL] | pieceBB[BLACK][ALL];
     }
+    
+    // Zobrist Hashing functions
     inline uint64_t getZobristKey() {
         uint64_t hash = 1;
 
         // Hash in pieces on the board
-        uint64_t bitboard = whitePawns;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[0][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackPawns;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[1][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteKnights;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[2][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackKnights;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[3][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteBishops;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[4][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackBishops;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[5][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteRooks;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[6][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackRooks;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[7][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteQueens;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[8][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackQueens;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[9][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = whiteKing;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[10][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
-        }
-        bitboard = blackKing;
-        while (bitboard) {
-            uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
-            hash ^= pieceHash[11][square]; // XOR with the Zobrist key for this piece on this square
-            bitboard &= bitboard - 1; // Clear the least significant bit set
+        for (int piece = PAWN; piece <= KING; ++piece) {
+            for (int color = WHITE; color <= BLACK; ++color) {
+                uint64_t bitboard = pieceBB[color][piece];
+                while (bitboard) {
+                    uint8_t square = ctz64(bitboard); // Find the index of the least significant bit set
+                    hash ^= ZOBRIST.pieceHash[(piece - 1) * 2 + color][square]; // XOR with the Zobrist key for this piece on this square
+                    bitboard &= bitboard - 1; // Clear the least significant bit set
+                }
+            }
         }
 
         // Add castling rights
         uint8_t castlingRights = castlingRightHistory[plycount];
-        hash ^= castlingHash[castlingRights];
+        hash ^= ZOBRIST.castlingHash[castlingRights];
 
         // Add en passant file
         uint8_t enPassantFile = enPassantFileHistory[plycount];
         if (~enPassantFile) { // if not all bits are set
-            hash ^= enPassantHash[enPassantFile];
+            hash ^= ZOBRIST.enPassantHash[enPassantFile];
         }
 
         // Incorporate the turn
-        (whiteToMove ? hash ^= whiteToMoveHash : hash);
+        (whiteToMove ? hash ^= ZOBRIST.whiteToMoveHash : hash);
 
         return hash;
     }
@@ -486,13 +371,13 @@ public:
         uint64_t startRank, notHFile, notAFile;
         
         if (whiteToMove) {
-            enemies = blackPieces;
+            enemies = pieceBB[BLACK][ALL];
             singlePush = (pawn << 8) & empty;
             doublePush = ((pawn & RANK_2) << 16) & empty & (empty << 8);
             leftCapture = (pawn << 7) & ~FILE_H & enemies;
             rightCapture = (pawn << 9) & ~FILE_A & enemies;
         } else {
-            enemies = whitePieces;
+            enemies = pieceBB[WHITE][ALL];
             singlePush = (pawn >> 8) & empty;
             doublePush = ((pawn & RANK_7) >> 16) & empty & (empty >> 8);
             leftCapture = (pawn >> 9) & ~FILE_H & enemies;
@@ -501,23 +386,19 @@ public:
         return singlePush | doublePush | leftCapture | rightCapture;
     }
     inline uint64_t rookMoveableSquare(uint8_t from){
-        const MagicEntry& entry = ROOK_MAGICS[from];
-        uint64_t index = ((allOccupied & entry.mask) * entry.magic) >> (64 - entry.shift);
-        uint64_t attacks = entry.moves[index];
-        uint64_t enemyPieces = whiteToMove ? blackPieces : whitePieces;
+        uint64_t attacks = rookAttacks(from, allOccupied);
+        uint64_t enemyPieces = whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL];
         return attacks & (enemyPieces | ~allOccupied);
     }
     inline uint64_t knightMoveableSquare(uint8_t from) {
         uint64_t knight_attacks = knight_lookup[from];
         uint64_t blockers;
-        blockers = whiteToMove ? whitePieces : blackPieces;
+        blockers = whiteToMove ? pieceBB[WHITE][ALL] : pieceBB[BLACK][ALL];
         return knight_attacks & ~blockers;
     }
     inline uint64_t bishopMoveableSquare(uint8_t from){
-        const MagicEntry& entry = BISHOP_MAGICS[from];
-        uint64_t index = ((allOccupied & entry.mask) * entry.magic) >> (64 - entry.shift);
-        uint64_t attacks = entry.moves[index];
-        uint64_t enemyPieces = whiteToMove ? blackPieces : whitePieces;
+        uint64_t attacks = bishopAttacks(from, allOccupied);
+        uint64_t enemyPieces = whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL];
         return attacks & (enemyPieces | ~allOccupied);
     }
     inline uint64_t queenMoveableSquare(uint8_t from){
@@ -527,40 +408,40 @@ public:
     }
     inline uint64_t kingMoveableSquare(uint8_t from) {
         uint64_t king_attacks = king_lookup[from];
-        uint64_t blockers = whiteToMove ? whitePieces : blackPieces;
+        uint64_t blockers = whiteToMove ? pieceBB[WHITE][ALL] : pieceBB[BLACK][ALL];
         uint64_t moveable_square = king_attacks & ~blockers;
         return moveable_square;
     }
     // calculate squares from enemy to own king (including enemy itself)
     inline uint64_t generateCheckedSquares() {
         uint64_t checkedSquares = 0xFFFFFFFFFFFFFFFFULL; // Start with all squares set
-        uint64_t kingBB = whiteToMove ? whiteKing : blackKing;
+        uint64_t kingBB = whiteToMove ? pieceBB[WHITE][KING] : pieceBB[BLACK][KING];
         int kingSquare = ctz64(kingBB);
-        uint64_t opponentPieces = whiteToMove ? blackPieces : whitePieces;
-        uint64_t ownPieces = whiteToMove ? whitePieces : blackPieces;
+        uint64_t opponentPieces = whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL];
+        uint64_t ownPieces = whiteToMove ? pieceBB[WHITE][ALL] : pieceBB[BLACK][ALL];
         uint64_t checkers = 0ULL;
 
         // Check for attacks by pawns
         uint64_t pawnAttacks = whiteToMove ? 
             ((kingBB << 7) & ~FILE_H) | ((kingBB << 9) & ~FILE_A) :
             ((kingBB >> 7) & ~FILE_A) | ((kingBB >> 9) & ~FILE_H);
-        uint64_t opponentPawns = whiteToMove ? blackPawns : whitePawns;
+        uint64_t opponentPawns = whiteToMove ? pieceBB[BLACK][PAWN] : pieceBB[WHITE][PAWN];
         checkers |= pawnAttacks & opponentPawns;
 
         // Check for attacks by knights
         uint64_t knightAttacks = knightMoveableSquare(kingSquare);
-        uint64_t opponentKnights = whiteToMove ? blackKnights : whiteKnights;
+        uint64_t opponentKnights = whiteToMove ? pieceBB[BLACK][KNIGHT] : pieceBB[WHITE][KNIGHT];
         checkers |= knightAttacks & opponentKnights;
 
         // Check for attacks by bishops and queens
         uint64_t bishopAttacks = bishopMoveableSquare(kingSquare);
-        uint64_t opponentBishopsQueens = whiteToMove ? (blackBishops | blackQueens) : (whiteBishops | whiteQueens);
+        uint64_t opponentBishopsQueens = whiteToMove ? (pieceBB[BLACK][BISHOP] | pieceBB[BLACK][QUEEN]) : (pieceBB[WHITE][BISHOP] | pieceBB[WHITE][QUEEN]);
         uint64_t bishopCheckers = bishopAttacks & opponentBishopsQueens;
         checkers |= bishopCheckers;
 
         // Check for attacks by rooks and queens
         uint64_t rookAttacks = rookMoveableSquare(kingSquare);
-        uint64_t opponentRooksQueens = whiteToMove ? (blackRooks | blackQueens) : (whiteRooks | whiteQueens);
+        uint64_t opponentRooksQueens = whiteToMove ? (pieceBB[BLACK][ROOK] | pieceBB[BLACK][QUEEN]) : (pieceBB[WHITE][ROOK] | pieceBB[WHITE][QUEEN]);
         uint64_t rookCheckers = rookAttacks & opponentRooksQueens;
         checkers |= rookCheckers;
 
@@ -572,15 +453,8 @@ public:
         } else if (numCheckers > 1) {
             return 0ULL; // Double check, no moves are valid (except for king moves)
         } else {
-            // Single check
-            uint64_t checkerSquare = 1ULL << ctz64(checkers);
-            if (bishopCheckers) {
-                return (bishopMoveableSquare(kingSquare) & bishopMoveableSquare(ctz64(checkerSquare))) | checkerSquare;
-            } else if (rookCheckers) {
-                return (rookMoveableSquare(kingSquare) & rookMoveableSquare(ctz64(checkerSquare))) | checkerSquare;
-            } else {
-                return checkerSquare; // For pawn or knight checks, only capturing the checker is valid
-            }
+            // Single check, block the ray of a slider or capture the checker
+            return BETWEEN[kingSquare][ctz64(checkers)];
         }
     }
     // calculate seen squares by enemy pieces
@@ -590,30 +464,30 @@ public:
         uint64_t kingmask;
         uint64_t opponentPieces, opponentPawns, opponentKnights, opponentBishops, opponentRooks, opponentQueens, opponentKing;
         if (whiteToMove) {
-            opponentPieces = blackPieces;
-            opponentPawns = blackPawns;
-            opponentKnights = blackKnights;
-            opponentBishops = blackBishops;
-            opponentRooks = blackRooks;
-            opponentQueens = blackQueens;
-            opponentKing = blackKing;
-
-            kingmask = 1ULL << ctz64(whiteKing);
-            whiteKing ^= kingmask;
-            whitePieces ^= kingmask;
+            opponentPieces = pieceBB[BLACK][ALL];
+            opponentPawns = pieceBB[BLACK][PAWN];
+            opponentKnights = pieceBB[BLACK][KNIGHT];
+            opponentBishops = pieceBB[BLACK][BISHOP];
+            opponentRooks = pieceBB[BLACK][ROOK];
+            opponentQueens = pieceBB[BLACK][QUEEN];
+            opponentKing = pieceBB[BLACK][KING];
+
+            kingmask = 1ULL << ctz64(pieceBB[WHITE][KING]);
+            pieceBB[WHITE][KING] ^= kingmask;
+            pieceBB[WHITE][ALL] ^= kingmask;
             allOccupied ^= kingmask;
         } else {
-            opponentPieces = whitePieces;
-            opponentPawns = whitePawns;
-            opponentKnights = whiteKnights;
-            opponentBishops = whiteBishops;
-            opponentRooks = whiteRooks;
-            opponentQueens = whiteQueens;
-            opponentKing = whiteKing;
-
-            kingmask = 1ULL << ctz64(blackKing);
-            blackKing ^= kingmask;
-            blackPieces ^= kingmask;
+            opponentPieces = pieceBB[WHITE][ALL];
+            opponentPawns = pieceBB[WHITE][PAWN];
+            opponentKnights = pieceBB[WHITE][KNIGHT];
+            opponentBishops = pieceBB[WHITE][BISHOP];
+            opponentRooks = pieceBB[WHITE][ROOK];
+            opponentQueens = pieceBB[WHITE][QUEEN];
+            opponentKing = pieceBB[WHITE][KING];
+
+            kingmask = 1ULL << ctz64(pieceBB[BLACK][KING]);
+            pieceBB[BLACK][KING] ^= kingmask;
+            pieceBB[BLACK][ALL] ^= kingmask;
             allOccupied ^= kingmask;
         }
 
@@ -634,140 +508,81 @@ public:
         }
 
         if (whiteToMove){
-            whiteKing ^= kingmask;
-            whitePieces ^= kingmask;
+            pieceBB[WHITE][KING] ^= kingmask;
+            pieceBB[WHITE][ALL] ^= kingmask;
             allOccupied ^= kingmask;
         } else{
-            blackKing ^= kingmask;
-            blackPieces ^= kingmask;
+            pieceBB[BLACK][KING] ^= kingmask;
+            pieceBB[BLACK][ALL] ^= kingmask;
             allOccupied ^= kingmask;
         }
         return seenSquares;
     }
-    // generate pin masks
+    // generate pin masks, the rays from our king to a pinner (pinner included)
     inline uint64_t generatePinD12(){
         uint64_t pinD12 = 0;
-        if (whiteToMove){
-            uint8_t kingSquare = ctz64(whiteKing);
-            const MagicEntry& entry = BISHOP_MAGICS[kingSquare];
-            uint64_t index = ((blackPieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (blackQueens | blackBishops);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenD12(pinnerSquare, kingSquare);
-                if (popcount64(betweenSquares & whitePieces) == 2){
-                    pinD12 |= betweenSquares;
-                }
-                pinners &= pinners - 1;
-            }
-        } else{
-            uint8_t kingSquare = ctz64(blackKing);
-            const MagicEntry& entry = BISHOP_MAGICS[kingSquare];
-            uint64_t index = ((whitePieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (whiteQueens | whiteBishops);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenD12(pinnerSquare, kingSquare);
-                if (popcount64(betweenSquares & blackPieces) == 2){
-                    pinD12 |= betweenSquares;
-                }
-                pinners &= pinners - 1;
+        uint64_t ownPieces = whiteToMove ? pieceBB[WHITE][ALL] : pieceBB[BLACK][ALL];
+        uint64_t opponentPieces = whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL];
+        uint8_t kingSquare = ctz64(whiteToMove ? pieceBB[WHITE][KING] : pieceBB[BLACK][KING]);
+        uint64_t pinners = bishopAttacks(kingSquare, opponentPieces) & (whiteToMove ? (pieceBB[BLACK][QUEEN] | pieceBB[BLACK][BISHOP]) : (pieceBB[WHITE][QUEEN] | pieceBB[WHITE][BISHOP]));
+        while (pinners) {
+            uint64_t ray = BETWEEN[kingSquare][ctz64(pinners)];
+            if (popcount64(ray & ownPieces) == 1){
+                pinD12 |= ray;
             }
+            pinners &= pinners - 1;
         }
         return pinD12;
     };
-    inline uint64_t betweenD12(uint8_t piecesquare, uint8_t kingsquare){
-        uint64_t mask = 0;
-    
-        // Calculate row and column difference
-        int row1 = piecesquare / 8;
-        int col1 = piecesquare % 8;
-        int row2 = kingsquare / 8;
-        int col2 = kingsquare % 8;
-        
-        int step;
-        
-        if (col2 > col1){
-            if (row2 > row1){
-                step = 9; // Moving up-right
-            }else{
-                step = -7; // Moving down-right
-            }
-        } else{
-            if (row2 > row1){
-                step = 7; // Moving up-left
-            }else{
-                step = -9; // Moving down-left
-            }
-        }
-
-        // Calculate the range of squares between square1 and square2
-        int steps = (kingsquare - piecesquare) / step; // add one extra step to include the square behind the king
-        
-        int sq = piecesquare; // start stepping at piecesquare
-        while ((steps >= 0) && (sq >= 0) && (sq <=63)) {
-            mask |= 1ULL << sq;
-            sq += step;
-            steps--;
-        }
-        return mask;
-    };
     inline uint64_t generatePinHV(){
         uint64_t pinHV = 0;
-        if (whiteToMove){
-            uint8_t kingSquare = ctz64(whiteKing);
-            const MagicEntry& entry = ROOK_MAGICS[kingSquare];
-            uint64_t index = ((blackPieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (blackQueens | blackRooks);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenHV(kingSquare, pinnerSquare);
-                if (popcount64(betweenSquares & whitePieces) == 2){
-                    pinHV |= betweenSquares;
-                }
-                pinners &= pinners - 1;
-            }
-        } else{
-            uint8_t kingSquare = ctz64(blackKing);
-            const MagicEntry& entry = ROOK_MAGICS[kingSquare];
-            uint64_t index = ((whitePieces & entry.mask) * entry.magic) >> (64 - entry.shift);
-            uint64_t pinners = entry.moves[index] & (whiteQueens | whiteRooks);
-            while (pinners) {
-                uint8_t pinnerSquare = ctz64(pinners);
-                uint64_t betweenSquares = betweenHV(kingSquare, pinnerSquare);
-                if (popcount64(betweenSquares & blackPieces) == 2){
-                    pinHV |= betweenSquares;
-                }
-                pinners &= pinners - 1;
+        uint64_t ownPieces = whiteToMove ? pieceBB[WHITE][ALL] : pieceBB[BLACK][ALL];
+        uint64_t opponentPieces = whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL];
+        uint8_t kingSquare = ctz64(whiteToMove ? pieceBB[WHITE][KING] : pieceBB[BLACK][KING]);
+        uint64_t pinners = rookAttacks(kingSquare, opponentPieces) & (whiteToMove ? (pieceBB[BLACK][QUEEN] | pieceBB[BLACK][ROOK]) : (pieceBB[WHITE][QUEEN] | pieceBB[WHITE][ROOK]));
+        while (pinners) {
+            uint64_t ray = BETWEEN[kingSquare][ctz64(pinners)];
+            if (popcount64(ray & ownPieces) == 1){
+                pinHV |= ray;
             }
+            pinners &= pinners - 1;
         }
         return pinHV;
     };
-    inline uint64_t betweenHV(uint8_t square1, uint8_t square2){
-        uint64_t mask = 0;
-        if (square1 % 8 == square2 % 8) { // If on the same file (vertically aligned)
-            int minSquare = std::min(square1, square2);
-            int maxSquare = std::max(square1, square2);
-            for (int i = minSquare; i <= maxSquare; i += 8) {
-                mask |= (1ULL << i);
-            }
-        }
-        else if (square1 / 8 == square2 / 8) { // If on the same rank (horizontally aligned)
-            int minSquare = std::min(square1, square2);
-            int maxSquare = std::max(square1, square2);
-            for (int i = minSquare; i <= maxSquare; ++i) {
-                mask |= (1ULL << i);
-            }
-        }
-        return mask;
-    };
+    // pawns of the side to move that can capture en passant, read off the check mask and pins instead of playing the
+    // capture, which would also update the accumulator twice. A pinned pawn has to stay on its pin line and in check
+    // the capture has to take the checker or block. Taking both pawns off the rank at once can uncover a rook or queen
+    // on it, which the pin masks don't see, so the king's rays are looked up with both pawns gone.
+    inline uint64_t enPassantCapturers(uint64_t checkedSquares, uint64_t pins) {
+        uint8_t enPassantFile = enPassantFileHistory[plycount];
+        if (enPassantFile == 0xFF) return 0;
+        int us = whiteToMove ? WHITE : BLACK;
+        int them = whiteToMove ? BLACK : WHITE;
+        uint64_t toBB = 1ULL << (enPassantFile + (whiteToMove ? 40 : 16));
+        uint64_t capturedBB = whiteToMove ? toBB >> 8 : toBB << 8;
+        if (!(checkedSquares & (toBB | capturedBB))) return 0;
+        uint8_t kingSquare = ctz64(pieceBB[us][KING]);
+        uint64_t capturers = 0;
+        uint64_t candidates = whiteToMove ? ((toBB >> 7) & ~FILE_A) | ((toBB >> 9) & ~FILE_H)
+                                          : ((toBB << 7) & ~FILE_H) | ((toBB << 9) & ~FILE_A);
+        for (uint64_t bb = candidates & pieceBB[us][PAWN]; bb; bb &= bb - 1){
+            uint8_t from = ctz64(bb);
+            uint64_t fromBB = 1ULL << from;
+            if ((fromBB & pins) && !(LINE[kingSquare][from] & toBB)) continue;
+            uint64_t occupied = (allOccupied ^ fromBB ^ capturedBB) | toBB;
+            if (rookAttacks(kingSquare, occupied) & (pieceBB[them][ROOK] | pieceBB[them][QUEEN])) continue;
+            if (bishopAttacks(kingSquare, occupied) & (pieceBB[them][BISHOP] | pieceBB[them][QUEEN])) continue;
+            capturers |= fromBB;
+        }
+        return capturers;
+    }
     // generate all legal moves in a position
     inline std::vector<uint16_t> generateAllLegalMoves() {
         std::vector<uint16_t> allLegalMoves;
         allLegalMoves.reserve(218);
         uint64_t seenSquares = generateSeenSquares();
         uint64_t checkedSquares = generateCheckedSquares();
-        uint64_t currentSidePieces = whiteToMove ? whitePieces : blackPieces;
+        uint64_t currentSidePieces = whiteToMove ? pieceBB[WHITE][ALL] : pieceBB[BLACK][ALL];
         
         uint64_t pinHV = generatePinHV();
         uint64_t pinD12 = generatePinD12();
@@ -787,91 +602,43 @@ public:
         uint64_t king;
 
         if (whiteToMove){
-            rook_nopin = whiteRooks & ~allPins;
-            rook_pin = whiteRooks & pinHV;
-            bishop_nopin = whiteBishops & ~allPins;
-            bishop_pin = whiteBishops & pinD12;
+            rook_nopin = pieceBB[WHITE][ROOK] & ~allPins;
+            rook_pin = pieceBB[WHITE][ROOK] & pinHV;
+            bishop_nopin = pieceBB[WHITE][BISHOP] & ~allPins;
+            bishop_pin = pieceBB[WHITE][BISHOP] & pinD12;
 
-            queen_nopin = whiteQueens & ~allPins; 
-            queen_pinHV = whiteQueens & pinHV;
-            queen_pinD12 = whiteQueens & pinD12;
+            queen_nopin = pieceBB[WHITE][QUEEN] & ~allPins; 
+            queen_pinHV = pieceBB[WHITE][QUEEN] & pinHV;
+            queen_pinD12 = pieceBB[WHITE][QUEEN] & pinD12;
 
-            pawns_nopin = whitePawns & ~allPins;
-            pawns_pinHV = whitePawns & pinHV;
-            pawns_pinD12 = whitePawns & pinD12;
+            pawns_nopin = pieceBB[WHITE][PAWN] & ~allPins;
+            pawns_pinHV = pieceBB[WHITE][PAWN] & pinHV;
+            pawns_pinD12 = pieceBB[WHITE][PAWN] & pinD12;
 
-            knight = whiteKnights & ~allPins; // a pinned knight can never move
-            king = whiteKing;
+            knight = pieceBB[WHITE][KNIGHT] & ~allPins; // a pinned knight can never move
+            king = pieceBB[WHITE][KING];
         } else{
-            rook_nopin = blackRooks & ~allPins;
-            rook_pin = blackRooks & pinHV;
-            bishop_nopin = blackBishops & ~allPins;
-            bishop_pin = blackBishops & pinD12;
+            rook_nopin = pieceBB[BLACK][ROOK] & ~allPins;
+            rook_pin = pieceBB[BLACK][ROOK] & pinHV;
+            bishop_nopin = pieceBB[BLACK][BISHOP] & ~allPins;
+            bishop_pin = pieceBB[BLACK][BISHOP] & pinD12;
 
-            queen_nopin = blackQueens & ~allPins; 
-            queen_pinHV = blackQueens & pinHV;
-            queen_pinD12 = blackQueens & pinD12;
+            queen_nopin = pieceBB[BLACK][QUEEN] & ~allPins; 
+            queen_pinHV = pieceBB[BLACK][QUEEN] & pinHV;
+            queen_pinD12 = pieceBB[BLACK][QUEEN] & pinD12;
 
-            pawns_nopin = blackPawns & ~allPins;
-            pawns_pinHV = blackPawns & pinHV;
-            pawns_pinD12 = blackPawns & pinD12;
+            pawns_nopin = pieceBB[BLACK][PAWN] & ~allPins;
+            pawns_pinHV = pieceBB[BLACK][PAWN] & pinHV;
+            pawns_pinD12 = pieceBB[BLACK][PAWN] & pinD12;
 
-            knight = blackKnights & ~allPins; // a pinned knight can never move
-            king = blackKing;
+            knight = pieceBB[BLACK][KNIGHT] & ~allPins; // a pinned knight can never move
+            king = pieceBB[BLACK][KING];
         }
 
-        // check for enPassantMove. Add if possible
-        uint8_t enPassantFile = enPassantFileHistory[plycount];
-        if (enPassantFile != 0xFF){
-            if (whiteToMove){
-                uint8_t enPassantSquare = enPassantFile + 40;
-                // Check if capture from left is possible, cant be file 0
-                if ((whitePawns & (1ULL << (enPassantFile + 31))) && enPassantFile != 0){
-                    uint16_t move = ((enPassantFile + 31) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-                 // Check if capture from right is possible, cant be file 7
-                if ((whitePawns & (1ULL << (enPassantFile + 33))) && enPassantFile != 7){
-                    uint16_t move = ((enPassantFile + 33) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-            } else{
-                uint8_t enPassantSquare = enPassantFile + 16;
-                // Check if capture from left is possible, cant be file 0
-                if ((blackPawns & (1ULL << (enPassantFile + 23))) && enPassantFile != 0){
-                    uint16_t move = ((enPassantFile + 23) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-                // Check if capture from right is possible, cant be file 7
-                if ((blackPawns & (1ULL << (enPassantFile + 25))) && enPassantFile != 7){
-                    uint16_t move = ((enPassantFile + 25) & 0x3F) | ((enPassantSquare & 0x3F) << 6);
-                    makeMove(move);
-                    whiteToMove = !whiteToMove; // flip because we want to see check on own king
-                    if (!isCheck()){
-                        allLegalMoves.emplace_back(move);
-                    }
-                    whiteToMove = !whiteToMove;
-                    unmakeMove();
-                }
-            }
+        // en passant captures
+        uint8_t enPassantSquare = enPassantFileHistory[plycount] + (whiteToMove ? 40 : 16);
+        for (uint64_t capturers = enPassantCapturers(checkedSquares, allPins); capturers; capturers &= capturers - 1){
+            allLegalMoves.emplace_back((ctz64(capturers) & 0x3F) | ((enPassantSquare & 0x3F) << 6));
         }
 
         // Add castling if possible
@@ -879,24 +646,24 @@ public:
             uint8_t castlingRights = castlingRightHistory[plycount];
             if (whiteToMove){
                 // castling right has to be set, rook has to be at square 7, squares 5 and 6 cant be seen or occupied 
-                if (((castlingRights & 8) >> 3) && (whiteRooks & (1ULL << 7)) && !(seenSquares & WKS_SEEN) && !(allOccupied & WKS_OCC)){
+                if (((castlingRights & 8) >> 3) && (pieceBB[WHITE][ROOK] & (1ULL << 7)) && !(seenSquares & WKS_SEEN) && !(allOccupied & WKS_OCC)){
                     uint16_t move = (4 & 0x3F) | ((6 & 0x3F) << 6) | (1 << 12);
                     allLegalMoves.emplace_back(move);
                 }
                 // castling right has to be set, rook has to be at square 0, squares 3 and 2 cant be seen and square 1 cant be occupied
-                if (((castlingRights & 4) >> 2) && (whiteRooks & (1ULL << 0)) && !(seenSquares & WQS_SEEN) && !(allOccupied & WQS_OCC)){
+                if (((castlingRights & 4) >> 2) && (pieceBB[WHITE][ROOK] & (1ULL << 0)) && !(seenSquares & WQS_SEEN) && !(allOccupied & WQS_OCC)){
                     uint16_t move = (4 & 0x3F) | ((2 & 0x3F) << 6) | (1 << 12);
                     allLegalMoves.emplace_back(move);
                 }
             }
             else{
                 // castling right has to be set, rook has to be at square 63, squares 61 and 62 cant be seen or occupied
-                if (((castlingRights & 2) >> 1) && (blackRooks & (1ULL << 63)) && !(seenSquares & BKS_SEEN) && !(allOccupied & BKS_OCC)){
+                if (((castlingRights & 2) >> 1) && (pieceBB[BLACK][ROOK] & (1ULL << 63)) && !(seenSquares & BKS_SEEN) && !(allOccupied & BKS_OCC)){
                     uint16_t move = (60 & 0x3F) | ((62 & 0x3F) << 6) | (1 << 12);
                     allLegalMoves.emplace_back(move);
                 }
                 // castling right has to be set, rook has to be at square 56, squares 59 and 58 cant be seen and square 57 cant be occupied
-                if ((castlingRights & 1) && (blackRooks & (1ULL << 56)) && !(seenSquares & BQS_SEEN) && !(allOccupied & BQS_OCC)){
+                if ((castlingRights & 1) && (pieceBB[BLACK][ROOK] & (1ULL << 56)) && !(seenSquares & BQS_SEEN) && !(allOccupied & BQS_OCC)){
                     uint16_t move = (60 & 0x3F) | ((58 & 0x3F) << 6) | (1 << 12);
                     allLegalMoves.emplace_back(move);
                 }
@@ -1088,15 +855,8 @@ public:
         // Update bitboards //
         if (whiteToMove){
             // Move the piece
-            whitePieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: whitePawns ^= fromToMask; break;
-                case 2: whiteKnights ^= fromToMask; break;
-                case 3: whiteBishops ^= fromToMask; break;
-                case 4: whiteRooks ^= fromToMask; break;
-                case 5: whiteQueens ^= fromToMask; break;
-                case 6: whiteKing ^= fromToMask; break;
-            }
+            pieceBB[WHITE][ALL] ^= fromToMask;
+            pieceBB[WHITE][movedPiece] ^= fromToMask;
             b_add_feature(to, movedPiece, true);
             b_remove_feature(from, movedPiece, true);
             // Handle en passant Capture
@@ -1104,34 +864,20 @@ public:
                 // if a pawn goes to the en passant square -> then en passant capture 
                 // en passant is happening
                 // clear black pawn one rank down
-                blackPawns &= ~(1ULL << (enPassantFile + 32));
-                blackPieces &= ~(1ULL << (enPassantFile + 32));
+                pieceBB[BLACK][PAWN] &= ~(1ULL << (enPassantFile + 32));
+                pieceBB[BLACK][ALL] &= ~(1ULL << (enPassantFile + 32));
                 b_remove_feature(enPassantFile + 32, 1, false);
             } 
             // Handle normal captures
             else if (capturedPiece != 0){
-                blackPieces &= ~toMask;
-                switch (capturedPiece) {
-                    case 1: blackPawns &= ~toMask; break;
-                    case 2: blackKnights &= ~toMask; break;
-                    case 3: blackBishops &= ~toMask; break;
-                    case 4: blackRooks &= ~toMask; break;
-                    case 5: blackQueens &= ~toMask; break;
-                    case 6: blackKing &= ~toMask; break;
-                }
+                pieceBB[BLACK][ALL] &= ~toMask;
+                pieceBB[BLACK][capturedPiece] &= ~toMask;
                 b_remove_feature(to, capturedPiece, false);
             }
         } else { // Black's move
             // Move the piece
-            blackPieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: blackPawns ^= fromToMask; break;
-                case 2: blackKnights ^= fromToMask; break;
-                case 3: blackBishops ^= fromToMask; break;
-                case 4: blackRooks ^= fromToMask; break;
-                case 5: blackQueens ^= fromToMask; break;
-                case 6: blackKing ^= fromToMask; break;
-            }
+            pieceBB[BLACK][ALL] ^= fromToMask;
+            pieceBB[BLACK][movedPiece] ^= fromToMask;
             w_add_feature(to, movedPiece, true);
             w_remove_feature(from, movedPiece, true);
 
@@ -1140,69 +886,32 @@ public:
                 // if a pawn goes to the en passant square -> then en passant capture 
                 // en passant is happening
                 // clear black pawn one rank up
-                whitePawns &= ~(1ULL << (enPassantFile + 24));
-                whitePieces &= ~(1ULL << (enPassantFile + 24));
+                pieceBB[WHITE][PAWN] &= ~(1ULL << (enPassantFile + 24));
+                pieceBB[WHITE][ALL] &= ~(1ULL << (enPassantFile + 24));
                 w_remove_feature(enPassantFile + 24, 1, false);
             } 
             // Handle normal captures
             else if (capturedPiece != 0){
-                whitePieces &= ~toMask;
-                switch (capturedPiece) {
-                    case 1: whitePawns &= ~toMask; break;
-                    case 2: whiteKnights &= ~toMask; break;
-                    case 3: whiteBishops &= ~toMask; break;
-                    case 4: whiteRooks &= ~toMask; break;
-                    case 5: whiteQueens &= ~toMask; break;
-                    case 6: whiteKing &= ~toMask; break;
-                }
+                pieceBB[WHITE][ALL] &= ~toMask;
+                pieceBB[WHITE][capturedPiece] &= ~toMask;
                 w_remove_feature(to, capturedPiece, false);
             }
         }
          // Handle promotion
         if ((move >> 15) & 0x1){
-            // no need to adjust whitePieces or blackPieces
+            // no need to adjust the color bitboards
             if (whiteToMove){
-                whitePawns &= ~toMask; // clear Pawn from promotion square
+                pieceBB[WHITE][PAWN] &= ~toMask; // clear Pawn from promotion square
                 b_remove_feature(to, 1, true);
-                switch ((move >> 13) & 0x3){
-                    case 3: 
-                        b_add_feature(to, 5, true);
-                        whiteQueens  |= toMask; 
-                        break;
-                    case 2: 
-                        b_add_feature(to, 4, true);
-                        whiteRooks   |= toMask; 
-                        break;
-                    case 1: 
-                        b_add_feature(to, 3, true);
-                        whiteBishops |= toMask; 
-                        break;
-                    case 0: 
-                        b_add_feature(to, 2, true);
-                        whiteKnights |= toMask; 
-                        break;
-                }
+                uint8_t promotedPiece = ((move >> 13) & 0x3) + 2;
+                b_add_feature(to, promotedPiece, true);
+                pieceBB[WHITE][promotedPiece] |= toMask;
             } else{
-                blackPawns &= ~toMask; // clear pawn from promotion square
+                pieceBB[BLACK][PAWN] &= ~toMask; // clear pawn from promotion square
                 w_remove_feature(to, 1, true);
-                switch ((move >> 13) & 0x3) {
-                    case 3: 
-                        w_add_feature(to, 5, true);
-                        blackQueens |= toMask; 
-                        break;
-                    case 2: 
-                        w_add_feature(to, 4, true);
-                        blackRooks |= toMask; 
-                        break;
-                    case 1: 
-                        w_add_feature(to, 3, true);
-                        blackBishops |= toMask; 
-                        break;
-                    case 0: 
-                        w_add_feature(to, 2, true);
-                        blackKnights |= toMask; 
-                        break;
-                }
+                uint8_t promotedPiece = ((move >> 13) & 0x3) + 2;
+                w_add_feature(to, promotedPiece, true);
+                pieceBB[BLACK][promotedPiece] |= toMask;
             }
         }
         // Handle castling
@@ -1210,49 +919,49 @@ public:
             if (std::abs(static_cast<int>(from) - static_cast<int>(to)) == 2){
                 switch (to){
                     case 6: // white king side
-                        whiteRooks &= ~(1ULL << 7); // set 7th bit to zero
-                        whiteRooks |= (1ULL << 5); // set 5th bit to one
+                        pieceBB[WHITE][ROOK] &= ~(1ULL << 7); // set 7th bit to zero
+                        pieceBB[WHITE][ROOK] |= (1ULL << 5); // set 5th bit to one
                         b_remove_feature(7, 4, true);
                         b_add_feature(5, 4, true);
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 7);
-                        whitePieces |= (1ULL << 5);
+                        // also change the white color bitboard
+                        pieceBB[WHITE][ALL] &= ~(1ULL << 7);
+                        pieceBB[WHITE][ALL] |= (1ULL << 5);
                         // set first two bits of castlingRights to zero
                         castlingRights &= ~(0x8);
                         castlingRights &= ~(0x4);
                         break;
                     case 2: // white queen side
-                        whiteRooks &= ~(1ULL << 0); // set 0th bit to zero
-                        whiteRooks |= (1ULL << 3); // set 3th bit to one
+                        pieceBB[WHITE][ROOK] &= ~(1ULL << 0); // set 0th bit to zero
+                        pieceBB[WHITE][ROOK] |= (1ULL << 3); // set 3th bit to one
                         b_remove_feature(0, 4, true);
                         b_add_feature(3, 4, true);
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 0);
-                        whitePieces |= (1ULL << 3);
+                        // also change the white color bitboard
+                        pieceBB[WHITE][ALL] &= ~(1ULL << 0);
+                        pieceBB[WHITE][ALL] |= (1ULL << 3);
                         // set first two bits of castlingRights to zero
                         castlingRights &= ~(0x8);
                         castlingRights &= ~(0x4);
                         break;
                     case 62: // black king side
-                        blackRooks &= ~(1ULL << 63); // set 63th bit to zero
-                        blackRooks |= (1ULL << 61); // set 59th bit to one
+                        pieceBB[BLACK][ROOK] &= ~(1ULL << 63); // set 63th bit to zero
+                        pieceBB[BLACK][ROOK] |= (1ULL << 61); // set 59th bit to one
                         w_remove_feature(63, 4, true);
                         w_add_feature(61, 4, true);
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 63);
-                        blackPieces |= (1ULL << 61);
+                        // also change the black color bitboard
+                        pieceBB[BLACK][ALL] &= ~(1ULL << 63);
+                        pieceBB[BLACK][ALL] |= (1ULL << 61);
                         // set last two bits of castlingRights to zero
                         castlingRights &= ~(0x2);
                         castlingRights &= ~(0x1);
                         break;
                     case 58: // black queen side
-                        blackRooks &= ~(1ULL << 56); // set 56th bit to zero
-                        blackRooks |= (1ULL << 59); // set 59th bit to one
+                        pieceBB[BLACK][ROOK] &= ~(1ULL << 56); // set 56th bit to zero
+                        pieceBB[BLACK][ROOK] |= (1ULL << 59); // set 59th bit to one
                         w_remove_feature(56, 4, true);
                         w_add_feature(59, 4, true);
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 56);
-                        blackPieces |= (1ULL << 59);
+                        // also change the black color bitboard
+                        pieceBB[BLACK][ALL] &= ~(1ULL << 56);
+                        pieceBB[BLACK][ALL] |= (1ULL << 59);
                         // set last two bits of castlingRights to zero
                         castlingRights &= ~(0x2);
                         castlingRights &= ~(0x1);
@@ -1296,7 +1005,7 @@ public:
         }
         
         // Set all Pieces
-        allOccupied = whitePieces | blackPieces;
+        allOccupied = pieceBB[WHITE][ALL] | pieceBB[BLACK][ALL];
 
         // Update game state information //
         plycount++;
@@ -1328,15 +1037,8 @@ public:
         // We're undoing the last move, so the current turn is opposite of the move we're undoing
         if (whiteToMove){
             // Move the piece back
-            blackPieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: blackPawns ^= fromToMask; break;
-                case 2: blackKnights ^= fromToMask; break;
-                case 3: blackBishops ^= fromToMask; break;
-                case 4: blackRooks ^= fromToMask; break;
-                case 5: blackQueens ^= fromToMask; break;
-                case 6: blackKing ^= fromToMask; break;
-            }
+            pieceBB[BLACK][ALL] ^= fromToMask;
+            pieceBB[BLACK][movedPiece] ^= fromToMask;
             w_remove_feature(to, movedPiece, true);
             w_add_feature(from, movedPiece, true);
             
@@ -1346,34 +1048,20 @@ public:
                 // if pawn has moved to the en passant square -> then en passant capture happened
                 // en passant has happened
                 // restore white pawn one file up
-                whitePawns |= (1ULL << (enPassantFile + 24));
-                whitePieces |= (1ULL << (enPassantFile + 24));
+                pieceBB[WHITE][PAWN] |= (1ULL << (enPassantFile + 24));
+                pieceBB[WHITE][ALL] |= (1ULL << (enPassantFile + 24));
                 w_add_feature(enPassantFile + 24, 1, false);
             }
             // Handle normal captures
             else if (capturedPiece != 0){
-                whitePieces |= toMask;
-                switch (capturedPiece) {
-                    case 1: whitePawns |= toMask; break;
-                    case 2: whiteKnights |= toMask; break;
-                    case 3: whiteBishops |= toMask; break;
-                    case 4: whiteRooks |= toMask; break;
-                    case 5: whiteQueens |= toMask; break;
-                    case 6: whiteKing |= toMask; break;
-                }
+                pieceBB[WHITE][ALL] |= toMask;
+                pieceBB[WHITE][capturedPiece] |= toMask;
                 w_add_feature(to, capturedPiece, false);
             }
         } else{ // remove black move
             // Move the piece back
-            whitePieces ^= fromToMask;
-            switch (movedPiece) {
-                case 1: whitePawns ^= fromToMask; break;
-                case 2: whiteKnights ^= fromToMask; break;
-                case 3: whiteBishops ^= fromToMask; break;
-                case 4: whiteRooks ^= fromToMask; break;
-                case 5: whiteQueens ^= fromToMask; break;
-                case 6: whiteKing ^= fromToMask; break;
-            }
+            pieceBB[WHITE][ALL] ^= fromToMask;
+            pieceBB[WHITE][movedPiece] ^= fromToMask;
             b_remove_feature(to, movedPiece, true);
             b_add_feature(from, movedPiece, true);
             
@@ -1383,69 +1071,32 @@ public:
                 // if pawn has moved to the en passant square -> then en passant capture happened
                 // en passant has happened
                 // restore white pawn one file up
-                blackPawns |= (1ULL << (enPassantFile + 32));
-                blackPieces |= (1ULL << (enPassantFile + 32));
+                pieceBB[BLACK][PAWN] |= (1ULL << (enPassantFile + 32));
+                pieceBB[BLACK][ALL] |= (1ULL << (enPassantFile + 32));
                 b_add_feature(enPassantFile + 32, 1, false);
             }
             // Handle normal captures
             else if (capturedPiece != 0){
-                blackPieces |= toMask;
-                switch (capturedPiece) {
-                    case 1: blackPawns |= toMask; break;
-                    case 2: blackKnights |= toMask; break;
-                    case 3: blackBishops |= toMask; break;
-                    case 4: blackRooks |= toMask; break;
-                    case 5: blackQueens |= toMask; break;
-                    case 6: blackKing |= toMask; break;
-                }
+                pieceBB[BLACK][ALL] |= toMask;
+                pieceBB[BLACK][capturedPiece] |= toMask;
                 b_add_feature(to, capturedPiece, false);
             }
         }
         // Handle promotion
         if ((move >> 15) & 0x1){
-            // no need to adjust whitePieces or blackPieces
+            // no need to adjust the color bitboards
             if (!whiteToMove){ // undoing white move
-                whitePawns |= fromMask; // add pawn
+                pieceBB[WHITE][PAWN] |= fromMask; // add pawn
                 b_add_feature(from, 1, true);
-                switch ((move >> 13) & 0x3) {
-                    case 3: 
-                        b_remove_feature(from, 5, true);
-                        whiteQueens &= ~fromMask; 
-                        break;
-                    case 2: 
-                        b_remove_feature(from, 4, true);
-                        whiteRooks &= ~fromMask; 
-                        break;
-                    case 1: 
-                        b_remove_feature(from, 3, true);
-                        whiteBishops &= ~fromMask; 
-                        break;
-                    case 0: 
-                        b_remove_feature(from, 2, true);
-                        whiteKnights &= ~fromMask; 
-                        break;
-                }
+                uint8_t promotedPiece = ((move >> 13) & 0x3) + 2;
+                b_remove_feature(from, promotedPiece, true);
+                pieceBB[WHITE][promotedPiece] &= ~fromMask;
             } else{
-                blackPawns |= fromMask; // add pawn
+                pieceBB[BLACK][PAWN] |= fromMask; // add pawn
                 w_add_feature(from, 1, true);
-                switch ((move >> 13) & 0x3) {
-                    case 3: 
-                        w_remove_feature(from, 5, true);
-                        blackQueens &= ~fromMask; 
-                        break;
-                    case 2: 
-                        w_remove_feature(from, 4, true);
-                        blackRooks &= ~fromMask; 
-                        break;
-                    case 1: 
-                        w_remove_feature(from, 3, true);
-                        blackBishops &= ~fromMask; 
-                        break;
-                    case 0: 
-                        w_remove_feature(from, 2, true);
-                        blackKnights &= ~fromMask; 
-                        break;
-                }
+                uint8_t promotedPiece = ((move >> 13) & 0x3) + 2;
+                w_remove_feature(from, promotedPiece, true);
+                pieceBB[BLACK][promotedPiece] &= ~fromMask;
             }
         }
         // Handle castling
@@ -1454,47 +1105,47 @@ public:
             if (std::abs(static_cast<int>(from) - static_cast<int>(to)) == 2){
                 switch (to) { // see where the king has moved to
                     case 6: // white king side
-                        whiteRooks &= ~(1ULL << 5); // set 5th bit to zero
-                        whiteRooks |= (1ULL << 7); // set 7th bit to one
+                        pieceBB[WHITE][ROOK] &= ~(1ULL << 5); // set 5th bit to zero
+                        pieceBB[WHITE][ROOK] |= (1ULL << 7); // set 7th bit to one
                         b_remove_feature(5, 4, true);
                         b_add_feature(7, 4, true);
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 5);
-                        whitePieces |= (1ULL << 7);
+                        // also change the white color bitboard
+                        pieceBB[WHITE][ALL] &= ~(1ULL << 5);
+                        pieceBB[WHITE][ALL] |= (1ULL << 7);
                         break;
                     case 2: // white queen side
-                        whiteRooks &= ~(1ULL << 3); // set 3rd bit to zero
-                        whiteRooks |= (1ULL << 0); // set 0th bit to one
+                        pieceBB[WHITE][ROOK] &= ~(1ULL << 3); // set 3rd bit to zero
+                        pieceBB[WHITE][ROOK] |= (1ULL << 0); // set 0th bit to one
                         b_remove_feature(3, 4, true);
                         b_add_feature(0, 4, true);
-                        // also change whitePieces
-                        whitePieces &= ~(1ULL << 3);
-                        whitePieces |= (1ULL << 0);
+                        // also change the white color bitboard
+                        pieceBB[WHITE][ALL] &= ~(1ULL << 3);
+                        pieceBB[WHITE][ALL] |= (1ULL << 0);
                         break;
                     case 62: // black king side
-                        blackRooks &= ~(1ULL << 61); // set 61th bit to zero
-                        blackRooks |= (1ULL << 63); // set 63th bit to one
+                        pieceBB[BLACK][ROOK] &= ~(1ULL << 61); // set 61th bit to zero
+                        pieceBB[BLACK][ROOK] |= (1ULL << 63); // set 63th bit to one
                         w_remove_feature(61, 4, true);
                         w_add_feature(63, 4, true);
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 61);
-                        blackPieces |= (1ULL << 63);
+                        // also change the black color bitboard
+                        pieceBB[BLACK][ALL] &= ~(1ULL << 61);
+                        pieceBB[BLACK][ALL] |= (1ULL << 63);
                         break;
                     case 58: // black queen side
-                        blackRooks &= ~(1ULL << 59); // set 59th bit to zero
-                        blackRooks |= (1ULL << 56); // set 56th bit to one
+                        pieceBB[BLACK][ROOK] &= ~(1ULL << 59); // set 59th bit to zero
+                        pieceBB[BLACK][ROOK] |= (1ULL << 56); // set 56th bit to one
                         w_remove_feature(59, 4, true);
                         w_add_feature(56, 4, true);
-                        // also change blackPieces
-                        blackPieces &= ~(1ULL << 59);
-                        blackPieces |= (1ULL << 56);
+                        // also change the black color bitboard
+                        pieceBB[BLACK][ALL] &= ~(1ULL << 59);
+                        pieceBB[BLACK][ALL] |= (1ULL << 56);
                         break;
                 }
             }
         }
 
         // Set all Pieces
-        allOccupied = whitePieces | blackPieces;
+        allOccupied = pieceBB[WHITE][ALL] | pieceBB[BLACK][ALL];
 
         // Update game state information //
         whiteToMove = !whiteToMove;
@@ -1510,54 +1161,50 @@ public:
 
     // Game end functions
     inline bool isCheck() {
-        uint8_t kingsquare = ctz64(whiteToMove ? whiteKing : blackKing);
+        uint8_t kingsquare = ctz64(whiteToMove ? pieceBB[WHITE][KING] : pieceBB[BLACK][KING]);
         
         // Pawn attacks
         // check left pawn attack
         bool left_pawn_attack = whiteToMove ? 
             // only check by panws if kingsquare < 48
-            (kingsquare < 48 && kingsquare % 8 != 0 && (blackPawns & (1ULL << (kingsquare + 7)))) :
+            (kingsquare < 48 && kingsquare % 8 != 0 && (pieceBB[BLACK][PAWN] & (1ULL << (kingsquare + 7)))) :
             // no check by pawns if kingsquare > 15
-            (kingsquare > 15 && kingsquare % 8 != 0 && (whitePawns & (1ULL << (kingsquare - 9))));
+            (kingsquare > 15 && kingsquare % 8 != 0 && (pieceBB[WHITE][PAWN] & (1ULL << (kingsquare - 9))));
         // check right pawn attack
         bool right_pawn_attack = whiteToMove ? 
-            (kingsquare < 48 && kingsquare % 8 != 7 && (blackPawns & (1ULL << (kingsquare + 9)))) :
-            (kingsquare > 15 && kingsquare % 8 != 7 && (whitePawns & (1ULL << (kingsquare - 7))));
+            (kingsquare < 48 && kingsquare % 8 != 7 && (pieceBB[BLACK][PAWN] & (1ULL << (kingsquare + 9)))) :
+            (kingsquare > 15 && kingsquare % 8 != 7 && (pieceBB[WHITE][PAWN] & (1ULL << (kingsquare - 7))));
 
         if (left_pawn_attack || right_pawn_attack) {
             return true;
         }
 
         // Knight attacks
-        uint64_t opponent_knights = whiteToMove ? blackKnights : whiteKnights;
+        uint64_t opponent_knights = whiteToMove ? pieceBB[BLACK][KNIGHT] : pieceBB[WHITE][KNIGHT];
         if (knight_lookup[kingsquare] & opponent_knights) {
             return true;
         }
 
         // Slider attacks
-        uint64_t opponent_bishops = whiteToMove ? blackBishops : whiteBishops;
-        uint64_t opponent_queens = whiteToMove ? blackQueens : whiteQueens;
-        uint64_t opponent_rooks = whiteToMove ? blackRooks : whiteRooks;
-        uint64_t enemyPieces = whiteToMove ? blackPieces : whitePieces;
+        uint64_t opponent_bishops = whiteToMove ? pieceBB[BLACK][BISHOP] : pieceBB[WHITE][BISHOP];
+        uint64_t opponent_queens = whiteToMove ? pieceBB[BLACK][QUEEN] : pieceBB[WHITE][QUEEN];
+        uint64_t opponent_rooks = whiteToMove ? pieceBB[BLACK][ROOK] : pieceBB[WHITE][ROOK];
+        uint64_t enemyPieces = whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL];
 
         // Bishop & Queen attacks
-        const MagicEntry& bishop_entry = BISHOP_MAGICS[kingsquare];
-        uint64_t bishop_index = ((allOccupied & bishop_entry.mask) * bishop_entry.magic) >> (64 - bishop_entry.shift);
-        uint64_t bishop_attacks = bishop_entry.moves[bishop_index] & (enemyPieces | ~allOccupied);
+        uint64_t bishop_attacks = bishopAttacks(kingsquare, allOccupied) & (enemyPieces | ~allOccupied);
         if (bishop_attacks & (opponent_bishops | opponent_queens)) {
             return true;
         }
 
         // Rook & Queen attacks
-        const MagicEntry& rook_entry = ROOK_MAGICS[kingsquare];
-        uint64_t rook_index = ((allOccupied & rook_entry.mask) * rook_entry.magic) >> (64 - rook_entry.shift);
-        uint64_t rook_attacks = rook_entry.moves[rook_index] & (enemyPieces | ~allOccupied);
+        uint64_t rook_attacks = rookAttacks(kingsquare, allOccupied) & (enemyPieces | ~allOccupied);
         if (rook_attacks & (opponent_rooks | opponent_queens)) {
             return true;
         }
 
         // King attacks
-        uint64_t opponent_king = whiteToMove ? blackKing : whiteKing;
+        uint64_t opponent_king = whiteToMove ? pieceBB[BLACK][KING] : pieceBB[WHITE][KING];
         if (king_lookup[kingsquare] & opponent_king) {
             return true;
         }
@@ -1595,17 +1242,17 @@ public:
     }
     bool isInsufficientMaterial() {
         // King vs. King
-        if (whitePieces == whiteKing && blackPieces == blackKing) {
+        if (pieceBB[WHITE][ALL] == pieceBB[WHITE][KING] && pieceBB[BLACK][ALL] == pieceBB[BLACK][KING]) {
             return true;
         }
         // King and Bishop vs. King
-        if ((whitePieces == (whiteKing | whiteBishops) && popcount64(whiteBishops) == 1 && blackPieces == blackKing) ||
-            (blackPieces == (blackKing | blackBishops) && popcount64(blackBishops) == 1 && whitePieces == whiteKing)) {
+        if ((pieceBB[WHITE][ALL] == (pieceBB[WHITE][KING] | pieceBB[WHITE][BISHOP]) && popcount64(pieceBB[WHITE][BISHOP]) == 1 && pieceBB[BLACK][ALL] == pieceBB[BLACK][KING]) ||
+            (pieceBB[BLACK][ALL] == (pieceBB[BLACK][KING] | pieceBB[BLACK][BISHOP]) && popcount64(pieceBB[BLACK][BISHOP]) == 1 && pieceBB[WHITE][ALL] == pieceBB[WHITE][KING])) {
             return true;
         }
         // King and Knight vs. King
-        if ((whitePieces == (whiteKing | whiteKnights) && popcount64(whiteKnights) == 1 && blackPieces == blackKing) ||
-            (blackPieces == (blackKing | blackKnights) && popcount64(blackKnights) == 1 && whitePieces == whiteKing)) {
+        if ((pieceBB[WHITE][ALL] == (pieceBB[WHITE][KING] | pieceBB[WHITE][KNIGHT]) && popcount64(pieceBB[WHITE][KNIGHT]) == 1 && pieceBB[BLACK][ALL] == pieceBB[BLACK][KING]) ||
+            (pieceBB[BLACK][ALL] == (pieceBB[BLACK][KING] | pieceBB[BLACK][KNIGHT]) && popcount64(pieceBB[BLACK][KNIGHT]) == 1 && pieceBB[WHITE][ALL] == pieceBB[WHITE][KING])) {
             return true;
         }
         return false;
@@ -1616,18 +1263,12 @@ public:
         }
         return generateAllLegalMoves().empty();
     }
+    // the current position occurred twice before, only positions since the last irreversible move can repeat
     bool isThreefoldRepetition() {
-        int startind = plycount - halfmoveClockHistory[plycount];
-        int endind = plycount;
-        std::unordered_map<uint64_t, int> keyCount;
-
-        //  Loop through the Zobrist key history
-        for (int i = startind; i <= endind; ++i) {
-            uint64_t key = zobristKeyHistory[i];
-            // Increment the count for this key
-            keyCount[key]++;
-            // If any key appears 3 times, we have a threefold repetition
-            if (keyCount[key] >= 3) {
+        int end = std::max(0, plycount - (int)halfmoveClockHistory[plycount]);
+        int count = 0;
+        for (int i = plycount - 4; i >= end; i -= 2) {
+            if (zobristKeyHistory[i] == zobristKey && ++count == 2) {
                 return true;
             }
         }
@@ -1653,17 +1294,17 @@ public:
     // Utility functions
     inline uint8_t getPieceOfSquare(uint8_t square) {
         uint64_t squareBB = 1ULL << square; 
-        if (squareBB & (whitePawns | blackPawns)) return 1;
-        if (squareBB & (whiteKnights | blackKnights)) return 2;
-        if (squareBB & (whiteBishops | blackBishops)) return 3;
-        if (squareBB & (whiteRooks | blackRooks)) return 4;
-        if (squareBB & (whiteQueens | blackQueens)) return 5;
-        if (squareBB & (whiteKing | blackKing)) return 6;
+        if (squareBB & (pieceBB[WHITE][PAWN] | pieceBB[BLACK][PAWN])) return 1;
+        if (squareBB & (pieceBB[WHITE][KNIGHT] | pieceBB[BLACK][KNIGHT])) return 2;
+        if (squareBB & (pieceBB[WHITE][BISHOP] | pieceBB[BLACK][BISHOP])) return 3;
+        if (squareBB & (pieceBB[WHITE][ROOK] | pieceBB[BLACK][ROOK])) return 4;
+        if (squareBB & (pieceBB[WHITE][QUEEN] | pieceBB[BLACK][QUEEN])) return 5;
+        if (squareBB & (pieceBB[WHITE][KING] | pieceBB[BLACK][KING])) return 6;
         return 0;
     }
     bool rightColor(uint8_t square){
         uint64_t squareBB = 1ULL << square;
-        return (whiteToMove && (whitePieces & squareBB)) || (!whiteToMove && (blackPieces & squareBB));
+        return (whiteToMove && (pieceBB[WHITE][ALL] & squareBB)) || (!whiteToMove && (pieceBB[BLACK][ALL] & squareBB));
     }
     uint16_t inputMove(uint8_t from, uint8_t to, uint8_t promotionPiece = 0){
         uint16_t data = (from & 0x3F) | ((to & 0x3F) << 6);
@@ -1730,18 +1371,10 @@ public:
     }
     std::vector<uint64_t> reportBitboards(){
         std::vector<uint64_t> bitboards;
-        bitboards.push_back(whitePawns);
-        bitboards.push_back(blackPawns);
-        bitboards.push_back(whiteKnights);
-        bitboards.push_back(blackKnights);
-        bitboards.push_back(whiteBishops);
-        bitboards.push_back(blackBishops);
-        bitboards.push_back(whiteRooks);
-        bitboards.push_back(blackRooks);
-        bitboards.push_back(whiteQueens);
-        bitboards.push_back(blackQueens);
-        bitboards.push_back(whiteKing);
-        bitboards.push_back(blackKing);
+        for (int piece = PAWN; piece <= KING; ++piece) {
+            bitboards.push_back(pieceBB[WHITE][piece]);
+            bitboards.push_back(pieceBB[BLACK][piece]);
+        }
         return bitboards;
     }
     std::vector<uint16_t> returnMoveHistory(){
@@ -1754,7 +1387,7 @@ public:
         return moveHistory[plycount-2];
     }
     bool isCapture(uint16_t move){
-        return (whiteToMove ? blackPieces : whitePieces) & (1Ull << (move >> 6) & 0x3F);
+        return (whiteToMove ? pieceBB[BLACK][ALL] : pieceBB[WHITE][ALL]) & (1Ull << (move >> 6) & 0x3F);
     }
     
     // NNUE
@@ -2027,211 +1660,24 @@ public:
     }
     std::vector<int16_t> getSparseFeatures(){
         std::vector<int16_t> sparseFeatures(1536, 0); // initialize with 0
-        if (whiteToMove){
-            uint64_t whitePawnsCopy = whitePawns;
-            while (whitePawnsCopy){
-                uint8_t square = ctz64(whitePawnsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 0] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 0 + 768] = 1.0f;
-                whitePawnsCopy &= whitePawnsCopy - 1;
-            }
-            uint64_t whiteKnightsCopy = whiteKnights;
-            while (whiteKnightsCopy){
-                uint8_t square = ctz64(whiteKnightsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 1] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 1 + 768] = 1.0f;
-                whiteKnightsCopy &= whiteKnightsCopy - 1;
-            }
-            uint64_t whiteBishopsCopy = whiteBishops;
-            while (whiteBishopsCopy){
-                uint8_t square = ctz64(whiteBishopsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 2] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 2 + 768] = 1.0f;
-                whiteBishopsCopy &= whiteBishopsCopy - 1;
-            }
-            uint64_t whiteRooksCopy = whiteRooks;
-            while (whiteRooksCopy){
-                uint8_t square = ctz64(whiteRooksCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 3] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 3 + 768] = 1.0f;
-                whiteRooksCopy &= whiteRooksCopy - 1;
-            }
-            uint64_t whiteQueensCopy = whiteQueens;
-            while (whiteQueensCopy){
-                uint8_t square = ctz64(whiteQueensCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 4] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 4 + 768] = 1.0f;
-                whiteQueensCopy &= whiteQueensCopy - 1;
-            }
-            uint64_t whiteKingCopy = whiteKing;
-            while (whiteKingCopy){
-                uint8_t square = ctz64(whiteKingCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 5] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 5 + 768] = 1.0f;
-                whiteKingCopy &= whiteKingCopy - 1;
-            }
-            uint64_t blackPawnsCopy = blackPawns;
-            while (blackPawnsCopy){
-                uint8_t square = ctz64(blackPawnsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 6] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 6 + 768] = 1.0f;
-                blackPawnsCopy &= blackPawnsCopy - 1;
-            }
-            uint64_t blackKnightsCopy = blackKnights;
-            while (blackKnightsCopy){
-                uint8_t square = ctz64(blackKnightsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 7] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 7 + 768] = 1.0f;
-                blackKnightsCopy &= blackKnightsCopy - 1;
-            }
-            uint64_t blackBishopsCopy = blackBishops;
-            while (blackBishopsCopy){
-                uint8_t square = ctz64(blackBishopsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 8] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 8 + 768] = 1.0f;
-                blackBishopsCopy &= blackBishopsCopy - 1;
-            }
-            uint64_t blackRooksCopy = blackRooks;
-            while (blackRooksCopy){
-                uint8_t square = ctz64(blackRooksCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 9] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 9 + 768] = 1.0f;
-                blackRooksCopy &= blackRooksCopy - 1;
-            }
-            uint64_t blackQueensCopy = blackQueens;
-            while (blackQueensCopy){
-                uint8_t square = ctz64(blackQueensCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 10] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 10 + 768] = 1.0f;
-                blackQueensCopy &= blackQueensCopy - 1;
-            }
-            uint64_t blackKingCopy = blackKing;
-            while (blackKingCopy){
-                uint8_t square = ctz64(blackKingCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                sparseFeatures[square*12 + 11] = 1.0f;
-                sparseFeatures[(flippedRank * 8 + square % 8)*12 + 11 + 768] = 1.0f;
-                blackKingCopy &= blackKingCopy - 1;
-            }
-        } else{
-            uint64_t whitePawnsCopy = whitePawns;
-            while (whitePawnsCopy){
-                uint8_t square = ctz64(whitePawnsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 6] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 6 + 768] = 1.0f;
-                whitePawnsCopy &= whitePawnsCopy - 1;
-            }
-            uint64_t whiteKnightsCopy = whiteKnights;
-            while (whiteKnightsCopy){
-                uint8_t square = ctz64(whiteKnightsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 7] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 7 + 768] = 1.0f;
-                whiteKnightsCopy &= whiteKnightsCopy - 1;
-            }
-            uint64_t whiteBishopsCopy = whiteBishops;
-            while (whiteBishopsCopy){
-                uint8_t square = ctz64(whiteBishopsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 8] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 8 + 768] = 1.0f;
-                whiteBishopsCopy &= whiteBishopsCopy - 1;
-            }
-            uint64_t whiteRooksCopy = whiteRooks;
-            while (whiteRooksCopy){
-                uint8_t square = ctz64(whiteRooksCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 9] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 9 + 768] = 1.0f;
-                whiteRooksCopy &= whiteRooksCopy - 1;
-            }
-            uint64_t whiteQueensCopy = whiteQueens;
-            while (whiteQueensCopy){
-                uint8_t square = ctz64(whiteQueensCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 10] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 10 + 768] = 1.0f;
-                whiteQueensCopy &= whiteQueensCopy - 1;
-            }
-            uint64_t whiteKingCopy = whiteKing;
-            while (whiteKingCopy){
-                uint8_t square = ctz64(whiteKingCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 11] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 11 + 768] = 1.0f;
-                whiteKingCopy &= whiteKingCopy - 1;
-            }
-            uint64_t blackPawnsCopy = blackPawns;
-            while (blackPawnsCopy){
-                uint8_t square = ctz64(blackPawnsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 0] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 0 + 768] = 1.0f;
-                blackPawnsCopy &= blackPawnsCopy - 1;
-            }
-            uint64_t blackKnightsCopy = blackKnights;
-            while (blackKnightsCopy){
-                uint8_t square = ctz64(blackKnightsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 1] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 1 + 768] = 1.0f;
-                blackKnightsCopy &= blackKnightsCopy - 1;
-            }
-            uint64_t blackBishopsCopy = blackBishops;
-            while (blackBishopsCopy){
-                uint8_t square = ctz64(blackBishopsCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 2] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 2 + 768] = 1.0f;
-                blackBishopsCopy &= blackBishopsCopy - 1;
-            }
-            uint64_t blackRooksCopy = blackRooks;
-            while (blackRooksCopy){
-                uint8_t square = ctz64(blackRooksCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 3] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 3 + 768] = 1.0f;
-                blackRooksCopy &= blackRooksCopy - 1;
-            }
-            uint64_t blackQueensCopy = blackQueens;
-            while (blackQueensCopy){
-                uint8_t square = ctz64(blackQueensCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 4] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 4 + 768] = 1.0f;
-                blackQueensCopy &= blackQueensCopy - 1;
-            }
-            uint64_t blackKingCopy = blackKing;
-            while (blackKingCopy){
-                uint8_t square = ctz64(blackKingCopy);
-                uint8_t flippedRank = abs(7 - (square / 8));
-                uint8_t flippedFile = abs(7 - (square % 8));
-                sparseFeatures[(flippedRank * 8 + flippedFile)*12 + 5] = 1.0f;
-                sparseFeatures[((square / 8) * 8 + flippedFile)*12 + 5 + 768] = 1.0f;
-                blackKingCopy &= blackKingCopy - 1;
+        for (int color = WHITE; color <= BLACK; ++color) {
+            for (int piece = PAWN; piece <= KING; ++piece) {
+                // planes 0-5 hold the pieces of the side to move, planes 6-11 the opponent pieces
+                int plane = ((color == WHITE) == whiteToMove ? 0 : 6) + piece - 1;
+                uint64_t bitboard = pieceBB[color][piece];
+                while (bitboard){
+                    uint8_t square = ctz64(bitboard);
+                    uint8_t flippedRank = abs(7 - (square / 8));
+                    uint8_t flippedFile = abs(7 - (square % 8));
+                    if (whiteToMove){
+                        sparseFeatures[square*12 + plane] = 1.0f;
+                        sparseFeatures[(flippedRank * 8 + square % 8)*12 + plane + 768] = 1.0f;
+                    } else{
+                        sparseFeatures[(flippedRank * 8 + flippedFile)*12 + plane] = 1.0f;
+                        sparseFeatures[((square / 8) * 8 + flippedFile)*12 + plane + 768] = 1.0f;
+                    }
+                    bitboard &= bitboard - 1;
+                }
             }
         }
 
@@ -2510,21 +1956,7 @@ public:
                 int square = rank * 8 + file;
                 char piece = '.';
                 for (int i = 0; i < 12; ++i) {
-                    uint64_t bb = 0ULL;
-                    switch (i) {
-                        case 0: bb = whitePawns; break;
-                        case 1: bb = whiteKnights; break;
-                        case 2: bb = whiteBishops; break;
-                        case 3: bb = whiteRooks; break;
-                        case 4: bb = whiteQueens; break;
-                        case 5: bb = whiteKing; break;
-                        case 6: bb = blackPawns; break;
-                        case 7: bb = blackKnights; break;
-                        case 8: bb = blackBishops; break;
-                        case 9: bb = blackRooks; break;
-                        case 10: bb = blackQueens; break;
-                        case 11: bb = blackKing; break;
-                    }
+                    uint64_t bb = pieceBB[i / 6][i % 6 + 1];
                     if (bb & (1ULL << square)) {
                         piece = pieces[i];
                         break;
@@ -2569,33 +2001,33 @@ public:
     }
     void printAll(){
         std::cout << "whitePawns: " << std::endl;
-        printBitboard(whitePawns);
+        printBitboard(pieceBB[WHITE][PAWN]);
         std::cout << "blackPawns: " << std::endl;
-        printBitboard(blackPawns);
+        printBitboard(pieceBB[BLACK][PAWN]);
         std::cout << "whiteKnights: " << std::endl;
-        printBitboard(whiteKnights);
+        printBitboard(pieceBB[WHITE][KNIGHT]);
         std::cout << "blackKnights: " << std::endl;
-        printBitboard(blackKnights);
+        printBitboard(pieceBB[BLACK][KNIGHT]);
         std::cout << "whiteBishops: " << std::endl;
-        printBitboard(whiteBishops);
+        printBitboard(pieceBB[WHITE][BISHOP]);
         std::cout << "blackBishops: " << std::endl;
-        printBitboard(blackBishops);
+        printBitboard(pieceBB[BLACK][BISHOP]);
         std::cout << "whiteRooks: " << std::endl;
-        printBitboard(whiteRooks);
+        printBitboard(pieceBB[WHITE][ROOK]);
         std::cout << "blackRooks: " << std::endl;
-        printBitboard(blackRooks);
+        printBitboard(pieceBB[BLACK][ROOK]);
         std::cout << "whiteQueens: " << std::endl;
-        printBitboard(whiteQueens);
+        printBitboard(pieceBB[WHITE][QUEEN]);
         std::cout << "blackQueens: " << std::endl;
-        printBitboard(blackQueens);
+        printBitboard(pieceBB[BLACK][QUEEN]);
         std::cout << "whiteKing: " << std::endl;
-        printBitboard(whiteKing);
+        printBitboard(pieceBB[WHITE][KING]);
         std::cout << "blackKing: " << std::endl;
-        printBitboard(blackKing);
+        printBitboard(pieceBB[BLACK][KING]);
         std::cout << "whitePieces: " << std::endl;
-        printBitboard(whitePieces);
+        printBitboard(pieceBB[WHITE][ALL]);
         std::cout << "blackPieces: " << std::endl;
-        printBitboard(blackPieces);
+        printBitboard(pieceBB[BLACK][ALL]);
         std::cout << "allOccupied: " << std::endl;
         printBitboard(allOccupied);
 
@@ -0,0 +1,70 @@
+#pragma once
+#include <cstdint>
+#include "Zobrist.hpp"
+
+// Cuckoo tables for upcoming repetition detection (Marcel van Kervinck's method, as used by Stockfish).
+// For every reversible move of a non pawn piece, i.e. piece, color and a pair of squares it could move between
+// on an empty board, the table holds the zobrist difference the move makes to a position key (side to move included).
+// If the current key and the key of an earlier position differ by exactly one such entry and nothing blocks that move,
+// the side to move can step back into the earlier position. 3668 moves, generated at compile time like the zobrist keys.
+struct CuckooTables {
+    uint64_t keys[8192];
+    uint16_t moves[8192]; // from | to << 6 as in the move encoding, 0 = empty slot
+};
+
+constexpr int cuckooH1(uint64_t key) {return key & 0x1FFF;}
+constexpr int cuckooH2(uint64_t key) {return (key >> 16) & 0x1FFF;}
+
+// squares a knight ... king (2 ... 6) attacks from square on an empty board
+constexpr uint64_t emptyBoardAttacks(int piece, int square) {
+    const int knightSteps[8][2] = {{1, 2}, {2, 1}, {2, -1}, {1, -2}, {-1, -2}, {-2, -1}, {-2, 1}, {-1, 2}};
+    const int kingSteps[8][2] = {{1, 0}, {1, 1}, {0, 1}, {-1, 1}, {-1, 0}, {-1, -1}, {0, -1}, {1, -1}};
+    bool slider = piece == 3 || piece == 4 || piece == 5;
+    uint64_t attacks = 0;
+    for (int i = 0; i < 8; ++i) {
+        const int* step = piece == 2 ? knightSteps[i] : kingSteps[i];
+        bool diagonal = step[0] != 0 && step[1] != 0;
+        if ((piece == 3 && !diagonal) || (piece == 4 && diagonal)) continue;
+        int file = square % 8 + step[0];
+        int rank = square / 8 + step[1];
+        while (file >= 0 && file < 8 && rank >= 0 && rank < 8) {
+            attacks |= 1ULL << (rank * 8 + file);
+            if (!slider) break;
+            file += step[0];
+            rank += step[1];
+        }
+    }
+    return attacks;
+}
+
+constexpr CuckooTables generateCuckooTables() {
+    CuckooTables tables{};
+    for (int piece = 2; piece <= 6; ++piece) {
+        for (int color = 0; color < 2; ++color) {
+            for (int s1 = 0; s1 < 64; ++s1) {
+                uint64_t attacks = emptyBoardAttacks(piece, s1);
+                for (int s2 = s1 + 1; s2 < 64; ++s2) {
+                    if (!((attacks >> s2) & 1)) continue;
+                    // same indexing as Board::pieceKey
+                    uint64_t key = ZOBRIST.pieceHash[(piece - 1) * 2 + color][s1] ^ ZOBRIST.pieceHash[(piece - 1) * 2 + color][s2] ^ ZOBRIST.whiteToMoveHash;
+                    uint16_t move = s1 | (s2 << 6);
+                    // insert, kicking the occupant over to its other slot until an empty slot is found
+                    int slot = cuckooH1(key);
+                    while (true) {
+                        uint64_t kickedKey = tables.keys[slot];
+                        uint16_t kickedMove = tables.moves[slot];
+                        tables.keys[slot] = key;
+                        tables.moves[slot] = move;
+                        if (kickedMove == 0) break;
+                        key = kickedKey;
+                        move = kickedMove;
+                        slot = (slot == cuckooH1(key)) ? cuckooH2(key) : cuckooH1(key);
+                    }
+                }
+            }
+        }
+    }
+    return tables;
+}
+
+inline constexpr CuckooTables CUCKOO = generateCuckooTables();
@@ -0,0 +1,140 @@
+#pragma once
+#include "Board.hpp"
+#include "Fen.hpp"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <fstream>
+#include <stdexcept>
+#include <cstring>
+#ifdef _WIN32
+    #include <iterator> // no mmap, the file is read into memory once instead
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+// Streams the positions of an EPD or FEN file (one position per line) into reusable Boards.
+// The file is memory mapped and every line is parsed straight from the mapping through string_views,
+// so the only allocations are the Boards themselves, one per thread, no matter how many positions the file holds.
+// Empty lines, comments (#) and lines without the four FEN fields are skipped.
+//
+//     EpdReader reader("positions.epd");
+//     reader.parallelForEach([&](Board& board, const FenFields& fields, int thread) {...});
+class EpdReader {
+public:
+    explicit EpdReader(const std::string& path) {
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::binary);
+        if (!file) throw std::runtime_error("Could not open file: " + path);
+        buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        data = buffer.data();
+        size = buffer.size();
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0) {
+            if (fd >= 0) close(fd);
+            throw std::runtime_error("Could not open file: " + path);
+        }
+        size = info.st_size;
+        if (size > 0) {
+            void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping == MAP_FAILED) {
+                close(fd);
+                throw std::runtime_error("Could not map file: " + path);
+            }
+            madvise(mapping, size, MADV_SEQUENTIAL);
+            data = static_cast<const char*>(mapping);
+        }
+        close(fd); // the mapping stays valid without the descriptor
+#endif
+    }
+    ~EpdReader() {
+#ifndef _WIN32
+        if (size > 0) munmap(const_cast<char*>(data), size);
+#endif
+    }
+    EpdReader(const EpdReader&) = delete;
+    EpdReader& operator=(const EpdReader&) = delete;
+
+    // the whole file
+    std::string_view text() const {return std::string_view(data, size);}
+
+    // visit(Board& board, const FenFields& fields) for every position in file order, returns the number of positions.
+    // The board and the views in fields are only valid during the call.
+    template<typename Visitor>
+    size_t forEach(Visitor&& visit) const {
+        Board board;
+        return parseRange(0, size, board, [&](Board& b, const FenFields& fields) {visit(b, fields);});
+    }
+
+    // visit(Board& board, const FenFields& fields, int thread) for every position, called concurrently from
+    // threads threads (0 = every hardware thread). The file is cut into chunks at line boundaries which the threads
+    // take one after another, so positions arrive out of order. Returns the number of positions.
+    template<typename Visitor>
+    size_t parallelForEach(Visitor&& visit, int threads = 0) const {
+        int numThreads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        // a few chunks per thread even out lines of different length and threads that get descheduled
+        size_t chunks = std::max<size_t>(1, std::min<size_t>(size / 4096 + 1, size_t(numThreads) * 16));
+        std::atomic<size_t> nextChunk(0);
+        std::atomic<size_t> total(0);
+
+        auto work = [&](int id) {
+            Board board;
+            size_t count = 0;
+            for (size_t chunk; (chunk = nextChunk.fetch_add(1, std::memory_order_relaxed)) < chunks;) {
+                size_t begin = lineStart(size * chunk / chunks);
+                size_t end = lineStart(size * (chunk + 1) / chunks);
+                count += parseRange(begin, end, board, [&](Board& b, const FenFields& fields) {visit(b, fields, id);});
+            }
+            total.fetch_add(count, std::memory_order_relaxed);
+        };
+
+        std::vector<std::thread> workers;
+        for (int id = 1; id < numThreads; ++id) workers.emplace_back(work, id);
+        work(0);
+        for (std::thread& worker : workers) worker.join();
+        return total.load();
+    }
+
+private:
+    const char* data = nullptr;
+    size_t size = 0;
+#ifdef _WIN32
+    std::string buffer;
+#endif
+
+    // first line start at or after offset, the chunk boundaries
+    size_t lineStart(size_t offset) const {
+        if (offset == 0 || offset >= size) return std::min(offset, size);
+        const void* newline = std::memchr(data + offset - 1, '\n', size - offset + 1);
+        return newline ? static_cast<const char*>(newline) - data + 1 : size;
+    }
+
+    // parse the lines in [begin, end), begin has to be the start of a line
+    template<typename Visitor>
+    size_t parseRange(size_t begin, size_t end, Board& board, Visitor&& visit) const {
+        size_t count = 0;
+        FenFields fields;
+        while (begin < end) {
+            const void* newline = std::memchr(data + begin, '\n', end - begin);
+            size_t lineEnd = newline ? static_cast<const char*>(newline) - data : end;
+            std::string_view line(data + begin, lineEnd - begin);
+            begin = lineEnd + 1;
+
+            size_t first = 0;
+            while (first < line.size() && isFenSpace(line[first])) first++;
+            if (first == line.size() || line[first] == '#') continue;
+            if (!splitFEN(line, fields)) continue;
+            board.setFEN(fields);
+            visit(board, fields);
+            count++;
+        }
+        return count;
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+// FEN / EPD line tokenizer shared by Board and Board_qNNUE.
+// Works on views into the caller's buffer, so parsing a position allocates nothing.
+// EPD lines carry only the first four FEN fields followed by operations ("D1 20;", "bm e4;" ...),
+// the move counters are therefore optional and default to 0 and 1.
+struct FenFields {
+    std::string_view placement;  // "rnbqkbnr/pppppppp/8/..."
+    std::string_view activeColor; // "w" or "b"
+    std::string_view castling;   // "KQkq" or "-"
+    std::string_view enPassant;  // "e3" or "-"
+    int halfmoveClock = 0;
+    int fullmoveNumber = 1;
+    std::string_view operations; // rest of the line after the FEN, empty for a plain FEN
+};
+
+inline bool isFenSpace(char c) {return c == ' ' || c == '\t' || c == '\r' || c == '\n';}
+
+// next whitespace separated token of text starting at pos, pos is moved behind it
+inline std::string_view nextFenToken(std::string_view text, size_t& pos) {
+    while (pos < text.size() && isFenSpace(text[pos])) pos++;
+    size_t start = pos;
+    while (pos < text.size() && !isFenSpace(text[pos])) pos++;
+    return text.substr(start, pos - start);
+}
+
+// the token as a move counter, false if it isn't a plain non negative number
+inline bool parseFenNumber(std::string_view token, int& value) {
+    if (token.empty() || token.size() > 9) return false;
+    int result = 0;
+    for (char c : token) {
+        if (c < '0' || c > '9') return false;
+        result = result * 10 + (c - '0');
+    }
+    value = result;
+    return true;
+}
+
+// split a FEN or EPD line into its fields, false if one of the four mandatory fields is missing
+inline bool splitFEN(std::string_view line, FenFields& fields) {
+    size_t pos = 0;
+    fields.placement = nextFenToken(line, pos);
+    fields.activeColor = nextFenToken(line, pos);
+    fields.castling = nextFenToken(line, pos);
+    fields.enPassant = nextFenToken(line, pos);
+    fields.halfmoveClock = 0;
+    fields.fullmoveNumber = 1;
+    if (fields.enPassant.empty()) {
+        fields.operations = std::string_view();
+        return false;
+    }
+
+    // optional move counters, anything else already belongs to the operations
+    size_t afterFields = pos;
+    if (parseFenNumber(nextFenToken(line, pos), fields.halfmoveClock)) {
+        afterFields = pos;
+        if (parseFenNumber(nextFenToken(line, pos), fields.fullmoveNumber)) afterFields = pos;
+    }
+    while (afterFields < line.size() && isFenSpace(line[afterFields])) afterFields++;
+    fields.operations = line.substr(afterFields);
+    return true;
+}
+
+// piece (1-6) of a FEN piece letter and whether it is white, 0 if the letter is none
+inline uint8_t fenPiece(char c, bool& white) {
+    white = c >= 'A' && c <= 'Z';
+    switch (c | 0x20) { // lower case
+        case 'p': return 1;
+        case 'n': return 2;
+        case 'b': return 3;
+        case 'r': return 4;
+        case 'q': return 5;
+        case 'k': return 6;
+    }
+    return 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// Everything makeMove overwrites that unmakeMove cannot recompute, for one ply.
+// 24 bytes, small enough that a ply never touches more than two cache lines.
+struct UndoRecord {
+    uint64_t zobristKey; // key of the position reached at this ply, for repetition detection
+    uint16_t move; // move that led to this position, 0 for the root
+    uint16_t halfmoveClock;
+    uint8_t capturedPiece; // captured piece of the move, can also be 0, a pawn for en passant
+    uint8_t castlingRights;
+    uint8_t enPassantFile;
+    uint8_t moveType; // MoveType of the move, so undo knows which case to reverse
+    uint16_t pliesFromNull; // plies since the root or the last null move, repetition scans must not look past it
+};
+static_assert(sizeof(UndoRecord) <= 64, "an undo record has to fit in one cache line");
+
+// Moves and irreversible state of every ply played since the last reset/FEN, kept apart from the Position.
+// records[0] is the root position and back() the current one. The stack grows with the game,
+// so long games and FENs with high move numbers cannot run off the end of it.
+struct GameHistory {
+    std::vector<UndoRecord> records; // storage of the stack, only grows
+    size_t count = 0; // number of records on the stack
+
+    GameHistory() : records(256) {}
+
+    inline void clear() {count = 0;}
+    // push the state of the position reached by move, move 0 is the root or a null move
+    inline void push(uint16_t move, uint8_t capturedPiece, uint8_t castling, uint8_t enPassantFile, uint16_t halfmoveClock, uint64_t zobristKey, uint8_t moveType = 0){
+        if (count == records.size()) grow();
+        uint16_t pliesFromNull = move ? records[count - 1].pliesFromNull + 1 : 0;
+        records[count++] = {zobristKey, move, halfmoveClock, capturedPiece, castling, enPassantFile, moveType, pliesFromNull};
+    }
+    inline void pop() {count--;}
+
+    inline size_t size() const {return count;}
+    inline const UndoRecord& back() const {return records[count-1];}
+    inline const UndoRecord& operator[](size_t i) const {return records[i];}
+
+private:
+    // kept out of line so the push in makeMove stays small
+#if defined(_MSC_VER)
+    __declspec(noinline)
+#else
+    __attribute__((noinline))
+#endif
+    void grow() {records.resize(records.size() * 2);}
+};
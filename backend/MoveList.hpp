@@ -0,0 +1,67 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+#include <type_traits>
+
+// Kind of a move, so make/unmake can go straight to the right case instead of working it out from the board
+enum MoveType : uint8_t {
+    MOVE_NORMAL = 0,      // quiet move or capture
+    MOVE_DOUBLE_PUSH = 1, // pawn two squares forward, sets the en passant file
+    MOVE_EN_PASSANT = 2,
+    MOVE_CASTLING = 3,    // king move of two squares, the rook comes along
+    MOVE_PROMOTION = 4    // with or without capture
+};
+
+// Which moves Board::generateMoves produces, the search picks captures before quiets
+enum GenType : int {
+    GEN_ALL = 0,
+    GEN_CAPTURES = 1, // captures, en passant and all promotions
+    GEN_QUIETS = 2    // everything else, castling included
+};
+
+// Move as the move generator hands it to the search and perft: the 16 bit encoding plus what
+// makeMove would otherwise look up. The 16 bit form stays what the TT, history tables and Python see.
+struct MoveRecord {
+    uint16_t move;    // from | to << 6 | castling << 12 | promotion piece << 13 | promotion << 15
+    uint8_t piece;    // moved piece, 1 = pawn ... 6 = king
+    uint8_t captured; // captured piece, 0 = none, a pawn for en passant
+    uint8_t type;     // MoveType
+};
+
+// Fixed capacity move list that lives on the stack.
+// The maximum number of legal moves in any reachable chess position is 218,
+// so 256 entries are always enough and no search or perft node has to touch the allocator.
+template<typename T>
+struct BasicMoveList {
+    static constexpr size_t CAPACITY = 256;
+
+    T moves[CAPACITY];
+    size_t count = 0;
+
+    inline void emplace_back(const T& move) {moves[count++] = move;}
+    inline void push_back(const T& move) {moves[count++] = move;}
+    // what the move generator calls, a list of plain 16 bit moves drops the rest
+    inline void add(uint16_t move, uint8_t piece, uint8_t captured, uint8_t type) {
+        if constexpr (std::is_same<T, MoveRecord>::value) {
+            moves[count++] = {move, piece, captured, type};
+        } else {
+            moves[count++] = move;
+        }
+    }
+    inline void clear() {count = 0;}
+    inline void resize(size_t n) {count = n;}
+
+    inline size_t size() const {return count;}
+    inline bool empty() const {return count == 0;}
+
+    inline T& operator[](size_t i) {return moves[i];}
+    inline const T& operator[](size_t i) const {return moves[i];}
+
+    inline T* begin() {return moves;}
+    inline T* end() {return moves + count;}
+    inline const T* begin() const {return moves;}
+    inline const T* end() const {return moves + count;}
+};
+
+using MoveList = BasicMoveList<uint16_t>;
+using MoveRecordList = BasicMoveList<MoveRecord>;
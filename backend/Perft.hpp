@@ -0,0 +1,230 @@
+#pragma once
+#include "Board.hpp"
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <atomic>
+
+// Parallel perft
+// The tree is split at the first one or two plies into tasks (the moves leading to a subtree).
+// The tasks are dealt round robin onto one deque per worker, a worker takes tasks from the front of
+// its own deque and steals from the back of the others once it runs dry.
+// Every worker walks its subtrees on its own Board copy, the only shared state is an optional PerftTT.
+
+struct PerftTask {
+    uint16_t moves[2]; // moves from the root to the subtree
+    uint8_t count;     // number of moves used
+};
+
+struct PerftThreadStats {
+    uint64_t nodes = 0;
+    uint64_t tasks = 0;  // subtrees searched
+    uint64_t stolen = 0; // of those taken from another worker
+    uint64_t probes = 0; // hash table lookups, only with a PerftTT
+    uint64_t hits = 0;
+    double seconds = 0;  // time spent searching
+};
+
+struct PerftResult {
+    uint64_t nodes = 0;
+    double seconds = 0;
+    std::vector<PerftThreadStats> threads;
+
+    double hitRate() const {
+        uint64_t probes = 0, hits = 0;
+        for (const PerftThreadStats& stats : threads) {
+            probes += stats.probes;
+            hits += stats.hits;
+        }
+        return probes ? double(hits) / probes : 0.0;
+    }
+};
+
+// Perft transposition table, (zobristKey, depth) -> node count, shared by all workers without locks.
+// An entry is two 64 bit words, the data (node count in the low 56 bits, depth in the top 8) and the
+// key xor'ed with the data. Two threads writing the same entry at once can leave the words mismatched,
+// the xor then no longer gives back the key and the probe just misses (https://www.chessprogramming.org/Shared_Hash_Table#Lockless).
+class PerftTT {
+public:
+    PerftTT(size_t megabytes = 256) {
+        size_t count = 1;
+        while (count * 2 * sizeof(Entry) <= megabytes * 1024 * 1024) count *= 2;
+        entries = std::vector<Entry>(count);
+        mask = count - 1;
+    }
+
+    void clear() {
+        for (Entry& entry : entries) {
+            entry.check.store(0, std::memory_order_relaxed);
+            entry.data.store(0, std::memory_order_relaxed);
+        }
+    }
+
+    inline bool probe(uint64_t key, int depth, uint64_t& nodes) const {
+        const Entry& entry = entries[key & mask];
+        uint64_t data = entry.data.load(std::memory_order_relaxed);
+        uint64_t check = entry.check.load(std::memory_order_relaxed);
+        if ((check ^ data) != key || int(data >> 56) != depth) return false;
+        nodes = data & NODE_MASK;
+        return true;
+    }
+
+    // always replace, the entries near the root are few and get rewritten by their own subtrees anyway
+    inline void store(uint64_t key, int depth, uint64_t nodes) {
+        Entry& entry = entries[key & mask];
+        uint64_t data = (uint64_t(depth) << 56) | (nodes & NODE_MASK);
+        entry.check.store(key ^ data, std::memory_order_relaxed);
+        entry.data.store(data, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr uint64_t NODE_MASK = (1ULL << 56) - 1;
+    struct Entry {
+        std::atomic<uint64_t> check;
+        std::atomic<uint64_t> data;
+    };
+    std::vector<Entry> entries;
+    uint64_t mask;
+};
+
+// perft that looks up and stores every interior node in the table, leaves are counted like Board::perft
+template<bool White, bool CopyMake = COPY_MAKE>
+inline uint64_t hashedPerft(Board& board, int depth, bool bulk, PerftTT& tt, PerftThreadStats& stats) {
+    if (depth == 0) return 1;
+    if (bulk && depth == 1) return board.countMoves<White>();
+    uint64_t nodes = 0;
+    stats.probes++;
+    if (tt.probe(board.zobristKey, depth, nodes)) {
+        stats.hits++;
+        return nodes;
+    }
+    MoveRecordList moves = board.generateMoves<White, MoveRecordList>();
+    Board::Snapshot before;
+    if constexpr (CopyMake) board.save(before);
+    for (const MoveRecord& move : moves) {
+        board.doMove<White>(move);
+        nodes += hashedPerft<!White, CopyMake>(board, depth - 1, bulk, tt, stats);
+        if constexpr (CopyMake) board.restore(before);
+        else board.undoMove<White>();
+    }
+    tt.store(board.zobristKey, depth, nodes);
+    return nodes;
+}
+
+class ParallelPerft {
+public:
+    // threads = 0 uses every hardware thread, splitPlies is clamped to depth - 1.
+    // With a table every worker caches its subtree counts in it and reuses the others'.
+    ParallelPerft(int threads = 0, int splitPlies = 2, PerftTT* tt = nullptr) : splitPlies(splitPlies), tt(tt) {
+        numThreads = threads > 0 ? threads : std::max(1u, std::thread::hardware_concurrency());
+        queues = std::vector<WorkQueue>(numThreads);
+    }
+
+    PerftResult run(const Board& root, int depth, bool bulk = true) {
+        PerftResult result;
+        result.threads.resize(numThreads);
+        auto start = std::chrono::steady_clock::now();
+
+        int plies = std::min(splitPlies, depth - 1);
+        if (plies < 1) {
+            // nothing to split, count the root on the calling thread
+            Board board = root;
+            result.nodes = result.threads[0].nodes = search(board, depth, bulk, result.threads[0]);
+            result.seconds = result.threads[0].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return result;
+        }
+
+        // split the tree and deal the tasks onto the worker queues
+        std::vector<PerftTask> tasks;
+        Board board = root;
+        PerftTask prefix = {{0, 0}, 0};
+        collectTasks(board, plies, prefix, tasks);
+        for (size_t i = 0; i < tasks.size(); ++i) {
+            queues[i % numThreads].tasks.push_back(tasks[i]);
+        }
+
+        std::vector<std::thread> workers;
+        for (int id = 0; id < numThreads; ++id) {
+            workers.emplace_back([this, &root, &result, id, depth, plies, bulk] {
+                work(root, id, depth - plies, bulk, result.threads[id]);
+            });
+        }
+        for (std::thread& worker : workers) worker.join();
+
+        for (const PerftThreadStats& stats : result.threads) result.nodes += stats.nodes;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return result;
+    }
+
+private:
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<PerftTask> tasks;
+    };
+
+    int numThreads;
+    int splitPlies;
+    PerftTT* tt;
+    std::vector<WorkQueue> queues;
+
+    uint64_t search(Board& board, int depth, bool bulk, PerftThreadStats& stats) {
+        if (!tt) return board.perft(depth, bulk);
+        return board.whiteToMove ? hashedPerft<true>(board, depth, bulk, *tt, stats)
+                                 : hashedPerft<false>(board, depth, bulk, *tt, stats);
+    }
+
+    void collectTasks(Board& board, int plies, PerftTask& prefix, std::vector<PerftTask>& tasks) {
+        if (plies == 0) {
+            tasks.push_back(prefix);
+            return;
+        }
+        MoveList moves = board.generateAllLegalMoves();
+        for (const uint16_t& move : moves) {
+            prefix.moves[prefix.count++] = move;
+            board.makeMove(move);
+            collectTasks(board, plies - 1, prefix, tasks);
+            board.unmakeMove();
+            prefix.count--;
+        }
+    }
+
+    // own queue first (front), then steal from the back of the others
+    bool nextTask(int id, PerftTask& task, bool& stolen) {
+        for (int i = 0; i < numThreads; ++i) {
+            WorkQueue& queue = queues[(id + i) % numThreads];
+            std::lock_guard<std::mutex> guard(queue.lock);
+            if (queue.tasks.empty()) continue;
+            if (i == 0) {
+                task = queue.tasks.front();
+                queue.tasks.pop_front();
+            } else {
+                task = queue.tasks.back();
+                queue.tasks.pop_back();
+            }
+            stolen = i != 0;
+            return true;
+        }
+        return false;
+    }
+
+    // stats are counted locally and written once at the end, the workers' entries share cache lines
+    void work(const Board& root, int id, int depth, bool bulk, PerftThreadStats& result) {
+        Board board = root;
+        PerftThreadStats stats;
+        PerftTask task;
+        bool stolen;
+        auto start = std::chrono::steady_clock::now();
+        while (nextTask(id, task, stolen)) {
+            for (int i = 0; i < task.count; ++i) board.makeMove(task.moves[i]);
+            stats.nodes += search(board, depth, bulk, stats);
+            for (int i = 0; i < task.count; ++i) board.unmakeMove();
+            stats.tasks++;
+            stats.stolen += stolen;
+        }
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result = stats;
+    }
+};
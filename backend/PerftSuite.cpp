@@ -0,0 +1,184 @@
+// Perft regression and speed suite driven by EPD files (FEN ;D1 n ;D2 n ...), built by the PerftSuite CMake target
+// or: clang++ -O3 -march=native -std=c++17 -pthread -o PerftSuite PerftSuite.cpp
+//
+// PerftSuite [options] <file.epd>...   check every listed depth of every position, exit code 1 on any mismatch
+//   --depth N      skip depths above N
+//   --threads N    worker threads, default all hardware threads
+//   --hash MB      share a perft hash table of MB megabytes between the workers, default off
+//   --json FILE    write the results per position as JSON, "-" for stdout
+//   --no-bulk      make and unmake every move down to the leaves instead of counting the moves at depth 1
+// PerftSuite divide <depth> <fen>      node count below every root move, for hunting down a mismatch
+#include "Board.hpp"
+#include "Perft.hpp"
+#include "EpdReader.hpp"
+#include <iostream>
+#include <fstream>
+#include <memory>
+#include <charconv>
+
+struct DepthResult {
+    int depth;
+    uint64_t expected;
+    uint64_t nodes;
+    double seconds;
+};
+
+struct EpdPosition {
+    std::string fen;
+    std::vector<std::pair<int, uint64_t>> expected; // depth -> node count
+    std::vector<DepthResult> results;
+    int failedDepth = 0; // shallowest wrong depth, 0 if all are correct
+};
+
+// the ";D1 20 ;D2 400 ..." operations of an EPD line
+bool parseDepths(std::string_view operations, EpdPosition& position) {
+    while (!operations.empty()) {
+        size_t end = std::min(operations.find(';'), operations.size());
+        std::string_view op = operations.substr(0, end);
+        operations.remove_prefix(std::min(end + 1, operations.size()));
+
+        size_t pos = 0;
+        std::string_view name = nextFenToken(op, pos);
+        std::string_view count = nextFenToken(op, pos);
+        int depth;
+        uint64_t nodes;
+        if (name.size() > 1 && name[0] == 'D' && parseFenNumber(name.substr(1), depth)
+            && std::from_chars(count.data(), count.data() + count.size(), nodes).ec == std::errc()) {
+            position.expected.push_back({depth, nodes});
+        }
+    }
+    return !position.expected.empty();
+}
+
+std::string jsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    return out;
+}
+
+void writeJson(std::ostream& out, const std::vector<EpdPosition>& positions, uint64_t totalNodes, double totalSeconds, bool allCorrect) {
+    out << "{\n  \"positions\": [\n";
+    for (size_t i = 0; i < positions.size(); ++i) {
+        const EpdPosition& position = positions[i];
+        out << "    {\"fen\": \"" << jsonEscape(position.fen) << "\", \"correct\": " << (position.failedDepth ? "false" : "true") << ", \"depths\": [";
+        for (size_t j = 0; j < position.results.size(); ++j) {
+            const DepthResult& r = position.results[j];
+            out << (j ? ", " : "") << "{\"depth\": " << r.depth << ", \"expected\": " << r.expected << ", \"nodes\": " << r.nodes
+                << ", \"seconds\": " << r.seconds << ", \"nps\": " << uint64_t(r.nodes / std::max(r.seconds, 1e-9)) << "}";
+        }
+        out << "]}" << (i + 1 < positions.size() ? "," : "") << "\n";
+    }
+    out << "  ],\n  \"nodes\": " << totalNodes << ",\n  \"seconds\": " << totalSeconds
+        << ",\n  \"nps\": " << uint64_t(totalNodes / std::max(totalSeconds, 1e-9))
+        << ",\n  \"correct\": " << (allCorrect ? "true" : "false") << "\n}\n";
+}
+
+int divide(int depth, const std::string& fen) {
+    Board board(fen);
+    uint64_t total = 0;
+    MoveList moves = board.generateAllLegalMoves();
+    for (const uint16_t& move : moves) {
+        board.makeMove(move);
+        uint64_t nodes = board.perft(depth - 1);
+        board.unmakeMove();
+        std::cout << board.moveToString(move) << ": " << nodes << std::endl;
+        total += nodes;
+    }
+    std::cout << std::endl << "Moves: " << moves.size() << std::endl << "Nodes: " << total << std::endl;
+    return 0;
+}
+
+int usage() {
+    std::cerr << "usage: PerftSuite [--depth N] [--threads N] [--hash MB] [--json FILE] [--no-bulk] <file.epd>..." << std::endl
+              << "       PerftSuite divide <depth> <fen>" << std::endl;
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> args(argv + 1, argv + argc);
+    if (args.empty()) return usage();
+
+    if (args[0] == "divide") {
+        if (args.size() < 3) return usage();
+        std::string fen = args[2];
+        for (size_t i = 3; i < args.size(); ++i) fen += " " + args[i];
+        return divide(std::stoi(args[1]), fen);
+    }
+
+    int maxDepth = 1 << 30;
+    int threads = 0;
+    size_t hashMB = 0;
+    std::string jsonPath;
+    bool bulk = true;
+    std::vector<std::string> files;
+    for (size_t i = 0; i < args.size(); ++i) {
+        bool hasValue = i + 1 < args.size();
+        if (args[i] == "--depth" && hasValue) maxDepth = std::stoi(args[++i]);
+        else if (args[i] == "--threads" && hasValue) threads = std::stoi(args[++i]);
+        else if (args[i] == "--hash" && hasValue) hashMB = std::stoul(args[++i]);
+        else if (args[i] == "--json" && hasValue) jsonPath = args[++i];
+        else if (args[i] == "--no-bulk") bulk = false;
+        else if (args[i].rfind("--", 0) == 0) return usage();
+        else files.push_back(args[i]);
+    }
+    if (files.empty()) return usage();
+
+    std::vector<EpdPosition> positions;
+    for (const std::string& path : files) {
+        try {
+            EpdReader reader(path);
+            reader.forEach([&](Board& board, const FenFields& fields) {
+                EpdPosition position;
+                if (!parseDepths(fields.operations, position)) return;
+                position.fen = board.BoardToFEN();
+                positions.push_back(position);
+            });
+        } catch (const std::runtime_error& e) {
+            std::cerr << e.what() << std::endl;
+            return 2;
+        }
+    }
+
+    std::unique_ptr<PerftTT> tt(hashMB ? new PerftTT(hashMB) : nullptr);
+    ParallelPerft perft(threads, 2, tt.get());
+    // JSON on stdout replaces the text report
+    std::ostream& log = jsonPath == "-" ? std::cerr : std::cout;
+    uint64_t totalNodes = 0;
+    double totalSeconds = 0;
+    size_t failed = 0;
+
+    for (size_t i = 0; i < positions.size(); ++i) {
+        EpdPosition& position = positions[i];
+        Board board(position.fen);
+        for (const auto& entry : position.expected) {
+            if (entry.first > maxDepth) continue;
+            PerftResult result = perft.run(board, entry.first, bulk);
+            position.results.push_back({entry.first, entry.second, result.nodes, result.seconds});
+            totalNodes += result.nodes;
+            totalSeconds += result.seconds;
+            if (result.nodes != entry.second) {
+                if (!position.failedDepth) position.failedDepth = entry.first;
+                log << "FAIL " << position.fen << " depth " << entry.first << ": " << result.nodes
+                    << " nodes (Expected: " << entry.second << ")" << std::endl;
+            }
+        }
+        if (position.failedDepth) {
+            failed++;
+            log << "     PerftSuite divide " << position.failedDepth << " \"" << position.fen << "\"" << std::endl;
+        }
+    }
+
+    log << positions.size() - failed << "/" << positions.size() << " positions correct, " << totalNodes << " nodes, "
+        << totalSeconds << " seconds, " << totalNodes / std::max(totalSeconds, 1e-9) / 1e6 << " Mnps" << std::endl;
+
+    if (jsonPath == "-") {
+        writeJson(std::cout, positions, totalNodes, totalSeconds, failed == 0);
+    } else if (!jsonPath.empty()) {
+        std::ofstream json(jsonPath);
+        writeJson(json, positions, totalNodes, totalSeconds, failed == 0);
+    }
+    return failed ? 1 : 0;
+}
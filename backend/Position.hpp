@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <type_traits>
+
+// Everything that describes one chess position, without the moves that led to it.
+// Small and trivially copyable, so copy-make, root copies for a search thread and snapshots are a plain memcpy.
+struct Position {
+    // Bitboards
+    // indexed [color][piece] with WHITE/BLACK and PAWN ... KING, [color][ALL] holds every piece of a color
+    uint64_t pieceBB[2][7];
+    uint64_t allOccupied;
+    uint64_t zobristKey;
+    // Square -> piece type (0 = empty, 1 = pawn ... 6 = king), kept in sync with the bitboards
+    uint8_t mailbox[64];
+
+    // Game State Information
+    bool whiteToMove;
+    uint8_t castlingRights; // 8 = white king side, 4 = white queen side, 2 = black king side, 1 = black queen side
+    uint8_t enPassantFile;  // file of the pawn that just made a double push, 0xFF = none
+    uint16_t halfmoveClock; // plies since the last capture or pawn move
+    int16_t fullmoveNumber;
+};
+static_assert(std::is_trivially_copyable<Position>::value, "Position has to stay memcpy-able");
+
+// Fixed size binary form of a Position, for datasets, caches and sending positions between processes.
+// The pieces are stored as 4 bit codes in ascending square order of the occupied squares, a legal position has
+// at most 32 pieces, so 16 bytes hold all of them. Multi byte fields are in the machine's (little endian) byte order.
+struct PackedPosition {
+    uint64_t occupied;       // every occupied square
+    uint8_t pieces[16];      // piece (1 = pawn ... 6 = king) | 8 for black, low nibble first, one per occupied square
+    uint8_t state;           // bit 0: black to move, bits 1-4: castling rights as in Position
+    uint8_t enPassantFile;   // 0xFF = none
+    uint16_t halfmoveClock;
+    uint16_t fullmoveNumber;
+    uint8_t reserved[2] = {0, 0};
+};
+static_assert(sizeof(PackedPosition) == 32, "a packed position has to stay 32 bytes");
+static_assert(std::is_trivially_copyable<PackedPosition>::value, "PackedPosition has to stay memcpy-able");
@@ -1,9 +1,13 @@
-// clang++ -O3 -march=native -std=c++17 -o Test.out TestSuite.cpp && ./Test.out
+// clang++ -O3 -march=native -std=c++17 -pthread -o Test.out TestSuite.cpp && ./Test.out
 // or
-// clang++ -O1 -march=native -std=c++14 -o Test.exe TestSuite.cpp && ./Test.exe
+// clang++ -O1 -march=native -std=c++17 -pthread -o Test.exe TestSuite.cpp && ./Test.exe
+// add -DWOKFISCH_DEBUG to cross-check the incremental zobrist keys against a full recomputation (slow)
+// add -DUSE_COPY_MAKE to make copy-make the default, the last section compares it with make/unmake either way
 
 // runs a bunch of perft tests from https://www.chessprogramming.org/Perft_Results
 #include "Board.hpp"
+#include "Perft.hpp"
+#include "Wokfisch.hpp"
 #include <iostream>
 #include <ctime>
 #include <chrono>
@@ -29,7 +33,7 @@ inline uint64_t perft(Board& board, int depth) {
         return 1;
     }
     uint64_t nodes = 0;
-    std::vector<uint16_t> moves = board.generateAllLegalMoves();
+    MoveList moves = board.generateAllLegalMoves();
     for (const uint16_t& move : moves) {
         board.makeMove(move);
         nodes += perft(board, depth - 1);
@@ -37,21 +41,168 @@ inline uint64_t perft(Board& board, int depth) {
     }
     return nodes;
 }
-// // with bulk leaf counting
-// inline uint64_t perft(Board& board, int depth) {
-//     if (depth == 1) {
-//         return board.generateAllLegalMoves().size();
-//     }
-//     uint64_t nodes = 0;
-//     std::vector<uint16_t> moves = board.generateAllLegalMoves();
-//     for (const uint16_t& move : moves) {
-//         board.makeMove(move);
-//         uint64_t child_nodes = perft(board, depth - 1);
-//         nodes += child_nodes;
-//         board.unmakeMove();
-//     } 
-//     return nodes;
-// }
+// same as perft, but the side to move is a template parameter so make/unmake and
+// move generation are called on their color specialized versions directly
+template<bool White>
+inline uint64_t perftTemplated(Board& board, int depth) {
+    if (depth == 0) {
+        return 1;
+    }
+    uint64_t nodes = 0;
+    MoveList moves = board.generateMoves<White>();
+    for (const uint16_t& move : moves) {
+        board.doMove<White>(move);
+        nodes += perftTemplated<!White>(board, depth - 1);
+        board.undoMove<White>();
+    }
+    return nodes;
+}
+// Reference for the color templated generator: the same legal move generation, but the side to move is read from
+// whiteToMove at runtime and every color dependent step branches on it, like Board did before generateMoves<White>.
+// Only here to time the templates against, perftRuntime also checks it produces the same trees.
+inline uint64_t runtimePawnAttacks(bool white, uint64_t pawnBB) {
+    return white ? ((pawnBB << 7) & ~FILE_H) | ((pawnBB << 9) & ~FILE_A)
+                 : ((pawnBB >> 9) & ~FILE_H) | ((pawnBB >> 7) & ~FILE_A);
+}
+inline MoveList runtimeGenerateMoves(Board& board) {
+    bool white = board.whiteToMove;
+    int us = white ? WHITE : BLACK;
+    int them = white ? BLACK : WHITE;
+    uint64_t own = board.pieceBB[us][ALL];
+    uint64_t enemy = board.pieceBB[them][ALL];
+    uint64_t occupied = board.allOccupied;
+    uint64_t kingBB = board.pieceBB[us][KING];
+    uint8_t kingSquare = ctz64(kingBB);
+    uint64_t enemyDiagonals = board.pieceBB[them][BISHOP] | board.pieceBB[them][QUEEN];
+    uint64_t enemyOrthogonals = board.pieceBB[them][ROOK] | board.pieceBB[them][QUEEN];
+
+    uint64_t checkers = (runtimePawnAttacks(white, kingBB) & board.pieceBB[them][PAWN])
+                      | (knight_lookup[kingSquare] & board.pieceBB[them][KNIGHT])
+                      | (bishopAttacks(kingSquare, occupied) & enemyDiagonals)
+                      | (rookAttacks(kingSquare, occupied) & enemyOrthogonals);
+    uint64_t checkMask = !checkers ? ~0ULL : (checkers & (checkers - 1)) ? 0 : BETWEEN[kingSquare][ctz64(checkers)];
+
+    // squares the enemy sees with our king taken off the board
+    uint64_t withoutKing = occupied ^ kingBB;
+    uint64_t seenSquares = runtimePawnAttacks(!white, board.pieceBB[them][PAWN]) | king_lookup[ctz64(board.pieceBB[them][KING])];
+    for (uint64_t bb = board.pieceBB[them][KNIGHT]; bb; bb &= bb - 1) seenSquares |= knight_lookup[ctz64(bb)];
+    for (uint64_t bb = enemyDiagonals; bb; bb &= bb - 1) seenSquares |= bishopAttacks(ctz64(bb), withoutKing);
+    for (uint64_t bb = enemyOrthogonals; bb; bb &= bb - 1) seenSquares |= rookAttacks(ctz64(bb), withoutKing);
+
+    uint64_t pinned = 0;
+    uint64_t pinners = (rookAttacks(kingSquare, enemy) & enemyOrthogonals) | (bishopAttacks(kingSquare, enemy) & enemyDiagonals);
+    for (; pinners; pinners &= pinners - 1) {
+        uint64_t ray = BETWEEN[kingSquare][ctz64(pinners)];
+        if (popcount64(ray & own) == 1) pinned |= ray & own;
+    }
+
+    MoveList moves;
+    for (uint64_t bb = king_lookup[kingSquare] & ~own & ~seenSquares; bb; bb &= bb - 1) {
+        uint8_t to = ctz64(bb);
+        moves.add(kingSquare | (to << 6), KING, board.mailbox[to], MOVE_NORMAL);
+    }
+    if (!checkMask) return moves; // double check
+
+    if (!checkers) {
+        uint8_t castlingRights = board.castlingRights;
+        if (white) {
+            if ((castlingRights & 8) && (board.pieceBB[WHITE][ROOK] & (1ULL << 7)) && !(seenSquares & WKS_SEEN) && !(occupied & WKS_OCC))
+                moves.add(4 | (6 << 6) | (1 << 12), KING, 0, MOVE_CASTLING);
+            if ((castlingRights & 4) && (board.pieceBB[WHITE][ROOK] & (1ULL << 0)) && !(seenSquares & WQS_SEEN) && !(occupied & WQS_OCC))
+                moves.add(4 | (2 << 6) | (1 << 12), KING, 0, MOVE_CASTLING);
+        } else {
+            if ((castlingRights & 2) && (board.pieceBB[BLACK][ROOK] & (1ULL << 63)) && !(seenSquares & BKS_SEEN) && !(occupied & BKS_OCC))
+                moves.add(60 | (62 << 6) | (1 << 12), KING, 0, MOVE_CASTLING);
+            if ((castlingRights & 1) && (board.pieceBB[BLACK][ROOK] & (1ULL << 56)) && !(seenSquares & BQS_SEEN) && !(occupied & BQS_OCC))
+                moves.add(60 | (58 << 6) | (1 << 12), KING, 0, MOVE_CASTLING);
+        }
+    }
+
+    if (board.enPassantFile != 0xFF) {
+        uint8_t to = board.enPassantFile + (white ? 40 : 16);
+        uint64_t toBB = 1ULL << to;
+        uint64_t capturedBB = white ? toBB >> 8 : toBB << 8;
+        for (uint64_t bb = runtimePawnAttacks(!white, toBB) & board.pieceBB[us][PAWN]; bb && (checkMask & (toBB | capturedBB)); bb &= bb - 1) {
+            uint8_t from = ctz64(bb);
+            uint64_t after = (occupied ^ (1ULL << from) ^ capturedBB) | toBB;
+            if (((1ULL << from) & pinned) && !(LINE[kingSquare][from] & toBB)) continue;
+            if ((rookAttacks(kingSquare, after) & enemyOrthogonals) || (bishopAttacks(kingSquare, after) & enemyDiagonals)) continue;
+            moves.add(from | (to << 6), PAWN, PAWN, MOVE_EN_PASSANT);
+        }
+    }
+
+    // every other piece square by square, a pinned piece stays on the line through its king
+    for (uint64_t bb = own & ~kingBB; bb; bb &= bb - 1) {
+        uint8_t from = ctz64(bb);
+        uint64_t fromBB = 1ULL << from;
+        uint8_t piece = board.mailbox[from];
+        uint64_t squares = 0;
+        switch (piece) {
+            case PAWN: {
+                uint64_t push = (white ? fromBB << 8 : fromBB >> 8) & ~occupied;
+                uint64_t doublePush = (white ? (push << 8) & RANK_4 : (push >> 8) & RANK_5) & ~occupied;
+                squares = push | doublePush | (runtimePawnAttacks(white, fromBB) & enemy);
+                break;
+            }
+            case KNIGHT: squares = knight_lookup[from] & ~own; break;
+            case BISHOP: squares = bishopAttacks(from, occupied) & ~own; break;
+            case ROOK: squares = rookAttacks(from, occupied) & ~own; break;
+            case QUEEN: squares = (bishopAttacks(from, occupied) | rookAttacks(from, occupied)) & ~own; break;
+        }
+        squares &= checkMask;
+        if (fromBB & pinned) squares &= LINE[kingSquare][from];
+        for (; squares; squares &= squares - 1) {
+            uint8_t to = ctz64(squares);
+            uint16_t move = from | (to << 6);
+            if (piece == PAWN && (to >= 56 || to < 8)) {
+                for (int promotionPiece = 0; promotionPiece < 4; ++promotionPiece) // knight, bishop, rook, queen
+                    moves.add(move | (1 << 15) | (promotionPiece << 13), PAWN, board.mailbox[to], MOVE_PROMOTION);
+            } else {
+                moves.add(move, piece, board.mailbox[to], piece == PAWN && (to - from == 16 || from - to == 16) ? MOVE_DOUBLE_PUSH : MOVE_NORMAL);
+            }
+        }
+    }
+    return moves;
+}
+// perft on runtimeGenerateMoves, make/unmake dispatch on whiteToMove like perft
+inline uint64_t perftRuntime(Board& board, int depth) {
+    if (depth == 0) {
+        return 1;
+    }
+    uint64_t nodes = 0;
+    MoveList moves = runtimeGenerateMoves(board);
+    for (const uint16_t& move : moves) {
+        board.makeMove(move);
+        nodes += perftRuntime(board, depth - 1);
+        board.unmakeMove();
+    }
+    return nodes;
+}
+// nodes per second of a fixed depth search from board, a new engine per run so both make modes search the same tree
+template<bool CopyMake>
+inline double searchNps(Board& board, int depth, uint64_t& nodes) {
+    Wokfisch* engine = new Wokfisch();
+    Timer timer(1000000000);
+    timer.StartTurn();
+    nodes = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int d = 1; d <= depth; ++d) { // iterative deepening like returnBestMove, without the time checks
+        engine->nodesVisited = 0;
+        engine->negaMax<CopyMake>(board, timer, 1000000000, 0, d, -1000000, 1000000, false);
+        nodes += engine->nodesVisited;
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    delete engine;
+    return nodes / std::chrono::duration<double>(end - start).count();
+}
+// nodes per second of a perft run
+template<typename PerftFunction>
+inline double perftNps(Board& board, int depth, PerftFunction perftFunction) {
+    auto start = std::chrono::high_resolution_clock::now();
+    uint64_t nodes = perftFunction(board, depth);
+    auto end = std::chrono::high_resolution_clock::now();
+    return nodes / std::chrono::duration<double>(end - start).count();
+}
 
 struct TestPosition {
     std::string fen;
@@ -107,4 +258,143 @@ int main() {
     std::cout << "Total nodes: " << total_nodes << ", Nodes per second: " 
               << (total_nodes / total_duration.count()) << std::endl;
     std::cout << "Total time: " << total_duration.count() << " seconds" << std::endl;
-}
\ No newline at end of file
+
+    // bulk leaf counting, the last ply is counted with Board::countMoves instead of generated and played
+    std::cout << std::endl << "Bulk leaf counting" << std::endl;
+    for (size_t pos = 0; pos < test_positions.size(); ++pos) {
+        Board board(test_positions[pos].fen);
+        int depth = test_positions[pos].max_depth;
+        auto start = std::chrono::high_resolution_clock::now();
+        uint64_t nodes = board.perft(depth, true);
+        auto end = std::chrono::high_resolution_clock::now();
+        double seconds = std::chrono::duration<double>(end - start).count();
+        std::cout << "Position " << pos + 1 << " depth " << depth << ": " << nodes << " nodes, "
+                  << nodes / seconds / 1e6 << " Mnps";
+        if (nodes == test_positions[pos].correct_moves[depth]) {
+            std::cout << " - Correct";
+        } else {
+            std::cout << " - Incorrect (Expected: " << test_positions[pos].correct_moves[depth] << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    // the same trees split over every hardware thread, each worker searches on its own Board copy
+    ParallelPerft parallelPerft;
+    std::cout << std::endl << "Parallel perft" << std::endl;
+    for (size_t pos = 0; pos < test_positions.size(); ++pos) {
+        Board board(test_positions[pos].fen);
+        int depth = test_positions[pos].max_depth;
+        PerftResult result = parallelPerft.run(board, depth, false);
+        std::cout << "Position " << pos + 1 << " depth " << depth << ": " << result.nodes << " nodes, "
+                  << result.nodes / result.seconds / 1e6 << " Mnps";
+        if (result.nodes == test_positions[pos].correct_moves[depth]) {
+            std::cout << " - Correct";
+        } else {
+            std::cout << " - Incorrect (Expected: " << test_positions[pos].correct_moves[depth] << ")";
+        }
+        std::cout << std::endl;
+        for (size_t t = 0; t < result.threads.size(); ++t) {
+            const PerftThreadStats& stats = result.threads[t];
+            std::cout << "    thread " << t << ": " << stats.nodes / std::max(stats.seconds, 1e-9) / 1e6 << " Mnps, "
+                      << stats.tasks << " subtrees (" << stats.stolen << " stolen)" << std::endl;
+        }
+    }
+
+    // deepest known count of every position, with a shared perft hash table and bulk leaf counting
+    PerftTT perftTT(256);
+    ParallelPerft hashedPerft(0, 2, &perftTT);
+    std::cout << std::endl << "Hashed parallel perft" << std::endl;
+    for (size_t pos = 0; pos < test_positions.size(); ++pos) {
+        Board board(test_positions[pos].fen);
+        int depth = test_positions[pos].correct_moves.size() - 1;
+        perftTT.clear();
+        PerftResult result = hashedPerft.run(board, depth, true);
+        std::cout << "Position " << pos + 1 << " depth " << depth << ": " << result.nodes << " nodes, "
+                  << result.seconds << " seconds, " << result.hitRate() * 100 << "% hash hits";
+        if (result.nodes == test_positions[pos].correct_moves[depth]) {
+            std::cout << " - Correct";
+        } else {
+            std::cout << " - Incorrect (Expected: " << test_positions[pos].correct_moves[depth] << ")";
+        }
+        std::cout << std::endl;
+    }
+
+    // repetitions are only looked for since the last null move, the positions before it had the other side to move
+    std::cout << std::endl << "Repetitions around null moves" << std::endl;
+    {
+        auto move = [](int from, int to) {return uint16_t(from | (to << 6));};
+        // Nf3, pass, Ng1, pass: the start position with white to move again, but only through two null moves
+        Board board(test_positions[0].fen);
+        board.makeMove(move(6, 21));
+        board.makeNullMove();
+        board.makeMove(move(21, 6));
+        board.makeNullMove();
+        bool falseRepetition = board.isRepeatedPosition(board.zobristKey) || board.isThreefoldRepetition() || board.hasUpcomingRepetition(10);
+        std::cout << "Null moves back to the root: " << (falseRepetition ? "Incorrect (repetition found)" : "Correct") << std::endl;
+
+        // pass, Nf6 Nf3 Ng8: Ng1 goes back to the position after the null move, which is on the search path
+        board = Board(test_positions[0].fen);
+        board.makeNullMove();
+        board.makeMove(move(62, 45));
+        board.makeMove(move(6, 21));
+        board.makeMove(move(45, 62));
+        bool upcoming = board.hasUpcomingRepetition(10);
+        board.makeMove(move(21, 6));
+        bool repeated = board.isRepeatedPosition(board.zobristKey);
+        std::cout << "Reversible moves after a null move: " << (upcoming && repeated ? "Correct" : "Incorrect (repetition missed)") << std::endl;
+    }
+
+    // compare the runtime branching generator with the color templated one, once behind the runtime side
+    // dispatch of generateAllLegalMoves/makeMove and once fully templated
+    std::cout << std::endl << "Runtime branching vs. runtime dispatch vs. templated perft" << std::endl;
+    for (size_t pos = 0; pos < 2; ++pos) {
+        Board board(test_positions[pos].fen);
+        int depth = test_positions[pos].max_depth - 1;
+        uint64_t runtimeNodes = 0;
+        double runtimeNps = perftNps(board, depth, [&runtimeNodes](Board& b, int d) {
+            return runtimeNodes = perftRuntime(b, d);
+        });
+        double dispatchNps = perftNps(board, depth, perft);
+        double templatedNps = perftNps(board, depth, [](Board& b, int d) {
+            return b.whiteToMove ? perftTemplated<true>(b, d) : perftTemplated<false>(b, d);
+        });
+        std::cout << "Position " << pos + 1 << " depth " << depth << ": "
+                  << runtimeNps / 1e6 << " Mnps runtime branching, "
+                  << dispatchNps / 1e6 << " Mnps runtime dispatch, "
+                  << templatedNps / 1e6 << " Mnps templated";
+        if (runtimeNodes != test_positions[pos].correct_moves[depth]) {
+            std::cout << " - Incorrect runtime branching perft (" << runtimeNodes << " nodes)";
+        }
+        std::cout << std::endl;
+    }
+
+    // compare taking moves back with undoMove against restoring a copy of the position, see COPY_MAKE
+    std::cout << std::endl << "Make/unmake vs. copy-make (default: " << (COPY_MAKE ? "copy-make" : "make/unmake") << ")" << std::endl;
+    for (size_t pos = 0; pos < 2; ++pos) {
+        Board board(test_positions[pos].fen);
+        int depth = test_positions[pos].max_depth - 1;
+        for (bool bulk : {false, true}) {
+            double unmakeNps = perftNps(board, depth, [bulk](Board& b, int d) {
+                return b.whiteToMove ? b.perftNodes<true, false>(d, bulk) : b.perftNodes<false, false>(d, bulk);
+            });
+            double copyNps = perftNps(board, depth, [bulk](Board& b, int d) {
+                return b.whiteToMove ? b.perftNodes<true, true>(d, bulk) : b.perftNodes<false, true>(d, bulk);
+            });
+            std::cout << "Position " << pos + 1 << " depth " << depth << (bulk ? " bulk" : "") << ": "
+                      << unmakeNps / 1e6 << " Mnps make/unmake, " << copyNps / 1e6 << " Mnps copy-make" << std::endl;
+        }
+    }
+    for (size_t pos = 0; pos < test_positions.size(); ++pos) {
+        Board board(test_positions[pos].fen);
+        int depth = 7;
+        uint64_t unmakeNodes, copyNodes;
+        double unmakeNps = searchNps<false>(board, depth, unmakeNodes);
+        double copyNps = searchNps<true>(board, depth, copyNodes);
+        std::cout << "Position " << pos + 1 << " search depth " << depth << ": "
+                  << unmakeNps / 1e6 << " Mnps make/unmake, " << copyNps / 1e6 << " Mnps copy-make";
+        if (unmakeNodes != copyNodes) {
+            std::cout << " - Searched different trees (" << unmakeNodes << " vs. " << copyNodes << " nodes)";
+        }
+        std::cout << std::endl;
+    }
+}
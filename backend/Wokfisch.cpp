@@ -1,6 +1,8 @@
 #include "Board.hpp"
 #include "Timer.hpp"
 #include <chrono>
+#include <algorithm>
+#include <limits>
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
 namespace py = pybind11;
@@ -111,6 +113,8 @@ public:
         }
         return rootBestMove;
     }
+    // CopyMake takes the moves back with Board::restore instead of unmakeMove, see COPY_MAKE
+    template<bool CopyMake = COPY_MAKE>
     int negaMax(Board& board, Timer& timer, int allocatedTime, int ply, int depth, int alpha, int beta, bool nullAllowed){
         ++nodesVisited;
         // Repetition detection
@@ -120,6 +124,13 @@ public:
         if (nullAllowed && board.isRepeatedPosition(key)){
             return 0;
         }
+        // If we can move back into a position of the game, the opponent cannot avoid a draw from here,
+        // so a line scoring below 0 for us is not worth searching.
+        if (ply > 0 && alpha < 0 && board.hasUpcomingRepetition(ply)){
+            alpha = 0;
+            if (alpha >= beta)
+                return alpha;
+        }
         // Check extension: if we are in check, we should search deeper. More info: https://www.chessprogramming.org/Check_Extensions
         bool inCheck = board.isCheck();
         if (inCheck)
@@ -143,7 +154,7 @@ public:
         // Local method for similar calls to Search, inspired by Tyrant7's approach here: https://github.com/Tyrant7/Chess-Challenge
         // We keep known values, but we create a local method that will be used to implement 3-fold PVS. More on that later on
         auto defaultSearch = [&](int beta, int reduction = 1, bool nullAllowed = true) {
-            return -negaMax(board, timer, allocatedTime, ply + 1, depth - reduction, -beta, -alpha, nullAllowed); // Return the score for consistency
+            return -negaMax<CopyMake>(board, timer, allocatedTime, ply + 1, depth - reduction, -beta, -alpha, nullAllowed); // Return the score for consistency
         };
 
         // Transposition table lookup
@@ -207,26 +218,35 @@ public:
             // pieces are pawns/kings, this reduces the cases of mis-evaluations of zugzwang in the end-game.
             // More info: https://www.chessprogramming.org/Null_Move_Pruning
             if (nullAllowed && score >= beta && depth > 2 && phase != 0){
-                board.whiteToMove = !board.whiteToMove; // MIGHT NEED IMPROVEMENT
+                board.makeNullMove();
                 defaultSearch(beta, 4 + depth / 6, false);
-                board.whiteToMove = !board.whiteToMove;
+                board.unmakeNullMove();
                 if (score >= beta)
                     return beta;
             }
         }
 
-        std::vector<uint16_t> moves = generateAndOrderMoves(board, ttMove, inQsearch, ply);
+        // Moves come in stages, see MovePicker. Qsearch only gets the captures that don't lose material
+        // according to the static exchange evaluation.
+        MovePicker picker(board, ttMove, killers[ply], quietHistory, inQsearch);
 
-        std::vector<uint16_t> quietsEvaluated;
+        int quietsEvaluated = 0;
         int movesEvaluated = 0;
         ttFlag = 0; // Upper
         
-        for (const auto& move : moves) {
+        for (MoveRecord record; picker.next(record);) {
+            uint16_t move = record.move;
+
             // A quiet move traditionally means a move that doesn't cause a capture to be the best move,
             // is not a promotion, and doesn't give check. For token savings we only consider captures.
             bool isQuiet = board.getPieceOfSquare(board.getTo(move));
+            // Checking moves are neither reduced nor counted for late move pruning, qsearch never reduces so it doesn't need to know
+            bool givesCheck = !inQsearch && board.givesCheck(move);
 
-            board.makeMove(move);
+            // saved after givesCheck, so the attack info it computed comes back with the position
+            Board::Snapshot before;
+            if constexpr (CopyMake) board.save(before);
+            board.makeMove(record);
 
             // Principal variation search
             // We trust that our move ordering is good enough to ensure the first move searched to be the best move most of the time,
@@ -239,14 +259,15 @@ public:
             // we can search shallower for not promising moves, most of which came later at our move ordering.
             // More info: https://www.chessprogramming.org/Late_Move_Reductions
             if (inQsearch || movesEvaluated == 0 // No PVS for first move or qsearch
-                || (depth <= 2 || movesEvaluated <= 4 || !isQuiet // Conditions not to do LMR
+                || (depth <= 2 || movesEvaluated <= 4 || !isQuiet || givesCheck // Conditions not to do LMR
                 // || defaultSearch(alpha + 1, depth / 2) > alpha)
                 || defaultSearch(alpha + 1, 2 + depth / 8 + movesEvaluated / 16 + static_cast<int>(doPruning) - compareTo(quietHistory[move & 4095], 0)) > alpha)
                 && alpha < defaultSearch(alpha + 1) && score < beta){ // Full depth search failed high
                 score = defaultSearch(beta); // Do full window search
             }
 
-            board.unmakeMove();
+            if constexpr (CopyMake) board.restore(before);
+            else board.unmakeMove();
 
             // If we are out of time, stop searching
             if (depth > 2 && timer.MillisecondsElapsedThisTurn() > allocatedTime){
@@ -278,12 +299,12 @@ public:
                 }
             }
 
-            if (isQuiet){
-                quietsEvaluated.emplace_back(move);
+            if (isQuiet && !givesCheck){
+                quietsEvaluated++;
             }
 
             // Late move pruning
-            if (doPruning && quietsEvaluated.size() > 3 + depth * depth)
+            if (doPruning && quietsEvaluated > 3 + depth * depth)
                 // std::cout << "LMP" << std::endl;
                 break;
         }
@@ -306,32 +327,14 @@ public:
         // Evaluate each piece type
         int gamePhase = calculateGamePhase(board);
             if (verbose) std::cout << "gamePhase: " << gamePhase << std::endl;
-        score += evaluatePiece(board.whitePawns, true, 1, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score -= evaluatePiece(board.blackPawns, false, 1, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score += evaluatePiece(board.whiteKnights, true, 2, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score -= evaluatePiece(board.blackKnights, false, 2, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score += evaluatePiece(board.whiteBishops, true, 3, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score -= evaluatePiece(board.blackBishops, false, 3, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score += evaluatePiece(board.whiteRooks, true, 4, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score -= evaluatePiece(board.blackRooks, false, 4, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score += evaluatePiece(board.whiteQueens, true, 5, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score -= evaluatePiece(board.blackQueens, false, 5, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score += evaluatePiece(board.whiteKing, true, 6, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-        score -= evaluatePiece(board.blackKing, false, 6, gamePhase);
-            if (verbose) std::cout << score << std::endl;
-
-        // score += kingDistanceScore(board.whiteKing, board.blackKing, board.whiteToMove, gamePhase);
+        for (int piece = PAWN; piece <= KING; ++piece) {
+            score += evaluatePiece(board.pieceBB[WHITE][piece], true, piece, gamePhase);
+                if (verbose) std::cout << score << std::endl;
+            score -= evaluatePiece(board.pieceBB[BLACK][piece], false, piece, gamePhase);
+                if (verbose) std::cout << score << std::endl;
+        }
+
+        // score += kingDistanceScore(board.pieceBB[WHITE][KING], board.pieceBB[BLACK][KING], board.whiteToMove, gamePhase);
 
         return board.whiteToMove ? score : -score;
     }
@@ -369,9 +372,9 @@ public:
         // Simple game phase calculation based on remaining material
         int gamePhase = 0;
 
-        gamePhase += popcount64(board.whiteBishops | board.whiteKnights | board.blackBishops | board. blackKnights) * 300;
-        gamePhase += popcount64(board.whiteRooks | board.blackRooks) * 500;
-        gamePhase += popcount64(board.whiteQueens | board.blackQueens) * 900;
+        gamePhase += popcount64(board.pieceBB[WHITE][BISHOP] | board.pieceBB[WHITE][KNIGHT] | board.pieceBB[BLACK][BISHOP] | board.pieceBB[BLACK][KNIGHT]) * 300;
+        gamePhase += popcount64(board.pieceBB[WHITE][ROOK] | board.pieceBB[BLACK][ROOK]) * 500;
+        gamePhase += popcount64(board.pieceBB[WHITE][QUEEN] | board.pieceBB[BLACK][QUEEN]) * 900;
 
         // Normalize gamePhase to a value between 0 and 32
         const int offset = 1000; // how fast will the endgame be reached?
@@ -429,38 +432,140 @@ public:
         
         std::cout << "Number of non-zero entries: " << nonZeroCount << std::endl;
     }
-    std::vector<uint16_t> generateAndOrderMoves(Board& board, const uint16_t& ttMove, bool inQsearch, int ply) {
-        std::vector<uint16_t> moves = board.generateAllLegalMoves();
-        
-        if (inQsearch) { // filter out captures
-            std::vector<uint16_t> nonQuietMoves;
-            for (const auto& move : moves) {
-                if (board.getPieceOfSquare(board.getTo(move)) != 0) {
-                    nonQuietMoves.push_back(move);
-                }
+    // Hands out the moves of a node one at a time, most promising first, and only generates what the search gets to:
+    // 1. the TT move, checked with Board::isLegal before anything is generated
+    // 2. captures, en passant and promotions, MVV-LVA with the ones losing material by static exchange evaluation last
+    // 3. the killer move
+    // 4. the remaining quiet moves by quiet history
+    // A cutoff by the TT move or a capture so never pays for generating and scoring the quiet moves.
+    // Qsearch only gets the captures that don't lose material.
+    class MovePicker {
+    public:
+        MovePicker(Board& board, uint16_t ttMove, uint16_t killer, const uint64_t* quietHistory, bool inQsearch)
+            : board(board), quietHistory(quietHistory), inQsearch(inQsearch), ttMove(0), killer(0) {
+            if (ttMove && board.isLegal(ttMove)){
+                ttRecord = board.moveRecord(ttMove);
+                if (!inQsearch || (isCaptureStage(ttRecord) && board.seeGE(ttMove, 0)))
+                    this->ttMove = ttMove;
+            }
+            if (!inQsearch && killer && killer != this->ttMove && board.isLegal(killer)){
+                killerRecord = board.moveRecord(killer);
+                if (!isCaptureStage(killerRecord))
+                    this->killer = killer;
             }
-            moves = nonQuietMoves;
         }
-        
-        std::sort(moves.begin(), moves.end(), [this, &board, &ttMove, ply](const uint16_t& a, const uint16_t& b) {
-            return getMoveScore(board, a, ttMove, ply) > getMoveScore(board, b, ttMove, ply);
-        });
-        
-        return moves;
-    }
-    int64_t getMoveScore(Board& board, const uint16_t& move, const uint16_t& ttMove, int ply) {
-        if (move == ttMove) {
-            return 9000000000000000LL;
+
+        // next move to search, false once every move was handed out
+        bool next(MoveRecord& record) {
+            switch (stage){
+                case TT_MOVE:
+                    stage = GENERATE_CAPTURES;
+                    if (ttMove){
+                        record = ttRecord;
+                        return true;
+                    }
+                    [[fallthrough]];
+                case GENERATE_CAPTURES:
+                    generateCaptures();
+                    stage = CAPTURES;
+                    [[fallthrough]];
+                case CAPTURES:
+                    while (current < moves.size()){
+                        // selection sort, a cutoff usually comes after the first few captures
+                        size_t best = current;
+                        for (size_t i = current + 1; i < moves.size(); ++i){
+                            if (scores[i] > scores[best]) best = i;
+                        }
+                        std::swap(moves[current], moves[best]);
+                        std::swap(scores[current], scores[best]);
+                        record = moves[current++];
+                        if (record.move != ttMove) return true;
+                    }
+                    stage = inQsearch ? DONE : KILLER;
+                    if (inQsearch) return false;
+                    [[fallthrough]];
+                case KILLER:
+                    stage = GENERATE_QUIETS;
+                    if (killer){
+                        record = killerRecord;
+                        return true;
+                    }
+                    [[fallthrough]];
+                case GENERATE_QUIETS:
+                    generateQuiets();
+                    stage = QUIETS;
+                    [[fallthrough]];
+                case QUIETS:
+                    while (current < moves.size()){
+                        record = moves[current++];
+                        if (record.move != ttMove && record.move != killer) return true;
+                    }
+                    stage = DONE;
+                    [[fallthrough]];
+                case DONE:
+                    return false;
+            }
+            return false;
         }
-        uint8_t capturePiece = board.getPieceOfSquare(board.getTo(move));
-        if (capturePiece) {
-            return 1000000000000000LL * static_cast<int64_t>(capturePiece) - static_cast<int64_t>(board.getPieceOfSquare(board.getFrom(move)));
+
+    private:
+        enum Stage {TT_MOVE, GENERATE_CAPTURES, CAPTURES, KILLER, GENERATE_QUIETS, QUIETS, DONE};
+
+        Board& board;
+        const uint64_t* quietHistory;
+        bool inQsearch;
+        uint16_t ttMove;
+        uint16_t killer;
+        MoveRecord ttRecord;
+        MoveRecord killerRecord;
+        Stage stage = TT_MOVE;
+        MoveRecordList moves;
+        int64_t scores[MoveRecordList::CAPACITY];
+        size_t current = 0;
+
+        // the moves Board::generateCaptureRecords produces
+        static bool isCaptureStage(const MoveRecord& record) {
+            return record.captured || record.type == MOVE_PROMOTION;
+        }
+
+        void generateCaptures() {
+            moves = board.generateCaptureRecords();
+            size_t kept = 0;
+            for (size_t i = 0; i < moves.size(); ++i){
+                const MoveRecord& record = moves[i];
+                // MVV-LVA, a queen promotion counts as winning the difference between queen and pawn
+                int64_t gain = record.captured + (((record.move >> 13) & 0x7) == 0x7 ? QUEEN - PAWN : 0);
+                int64_t mvvLva = 1000000000000000LL * gain - static_cast<int64_t>(record.piece);
+                // the exchange evaluation is only done once per capture, not in every comparison
+                bool good = board.seeGE(record.move, 0);
+                if (inQsearch && !good) continue;
+                moves[kept] = record;
+                scores[kept++] = good ? mvvLva : 600000000000000LL + mvvLva / 1000;
+            }
+            moves.resize(kept);
+            current = 0;
         }
-        if (move == killers[ply]) {
-            return 500000000000000LL;
+
+        void generateQuiets() {
+            moves = board.generateQuietRecords();
+            // Moves with equal history go by the moved piece, minor pieces and the queen before rooks and pawns,
+            // the king last, instead of the generator's order which starts with every pawn push.
+            static constexpr int PIECE_ORDER[7] = {0, 2, 5, 4, 3, 6, 1};
+            // insertion sort, no allocation and fast for the few dozen quiet moves of a position
+            for (size_t i = 0; i < moves.size(); ++i){
+                MoveRecord record = moves[i];
+                int64_t score = static_cast<int64_t>(quietHistory[record.move & 4095]);
+                size_t j = i;
+                for (; j > 0 && (scores[j - 1] < score || (scores[j - 1] == score && PIECE_ORDER[moves[j - 1].piece] < PIECE_ORDER[record.piece])); --j){
+                    moves[j] = moves[j - 1];
+                    scores[j] = scores[j - 1];
+                }
+                moves[j] = record;
+                scores[j] = score;
+            }
+            current = 0;
         }
-        return quietHistory[move & 4095];
-    }
+    };
     
 
 private:
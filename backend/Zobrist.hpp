@@ -0,0 +1,43 @@
+#pragma once
+#include <cstdint>
+
+// Zobrist hash values
+// One fixed-seed key set, generated at compile time and shared by every Board and Board_qNNUE.
+// The keys are identical across instances, runs and builds, so transposition tables, opening books
+// and hashes persisted to disk stay comparable. Changing ZOBRIST_SEED invalidates all stored hashes.
+constexpr uint64_t ZOBRIST_SEED = 0x576F6B6669736368ULL; // "Wokfisch"
+
+struct ZobristKeys {
+    uint64_t pieceHash[12][64]; // 12 types of pieces (6 white + 6 black) and 64 squares
+    uint64_t whiteToMoveHash;   // 1 element for current side
+    uint64_t castlingHash[16];  // 16 possible castling rights (4 bits)
+    uint64_t enPassantHash[8];  // 8 possible en passant files
+};
+
+// SplitMix64 step, see https://prng.di.unimi.it/splitmix64.c
+constexpr uint64_t splitMix64(uint64_t& state) {
+    uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys generateZobristKeys(uint64_t seed) {
+    ZobristKeys keys{};
+    uint64_t state = seed;
+    for (int pieceType = 0; pieceType < 12; ++pieceType) {
+        for (int square = 0; square < 64; ++square) {
+            keys.pieceHash[pieceType][square] = splitMix64(state);
+        }
+    }
+    keys.whiteToMoveHash = splitMix64(state);
+    for (int i = 0; i < 16; ++i) {
+        keys.castlingHash[i] = splitMix64(state);
+    }
+    for (int i = 0; i < 8; ++i) {
+        keys.enPassantHash[i] = splitMix64(state);
+    }
+    return keys;
+}
+
+inline constexpr ZobristKeys ZOBRIST = generateZobristKeys(ZOBRIST_SEED);